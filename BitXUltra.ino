@@ -23,6 +23,10 @@
 // Structures and other non-config definitions in bitxultra.h
 #include "bitxultra.h"
 
+#if HAVE_FASTBOOT
+#include <avr/wdt.h>
+#endif
+
 Si5351 si5351;
 
 /**
@@ -38,6 +42,9 @@ char c[30], b[20];
 
 struct state state;
 struct vfo vfos[VFO_COUNT];
+#if HAVE_MEMSTATS
+const unsigned int mem_main = sizeof(c) + sizeof(b) + sizeof(state) + sizeof(vfos);
+#endif
 enum modes mode = MODE_NORMAL;
  
 
@@ -95,7 +102,7 @@ void calibrate(){
 
     // The tuning knob gives readings from 0 to 1000
     // Each step is taken as 10 Hz and the mid setting of the knob is taken as zero
-    cal = (analogRead(ANALOG_TUNING) - 500) * 500ULL;
+    cal = (knobPos() - 500) * 500ULL;
 
     // if the button is released, we save the setting
     // and delay anything else by 5 seconds to debounce the CAL_BUTTON
@@ -143,36 +150,79 @@ void calibrate(){
  * Thus, setting the VFO on either side of the BFO will flip between the USB and LSB signals.
  */
 
-// without regard for filters and RIT.
-void _setFrequency(Frequency f, long fine) {
+// the VFO (local oscillator) output for dial frequency f
+static Frequency loFrequency(enum modulation mod, Frequency f) {
   Frequency bfo=bfo_freq+state.bfo_trim;
-  switch (vfos[state.vfoActive].mod) {
+  switch (mod) {
     case MOD_LSB:  f = bfo - f; break;
     case MOD_USB:  f = bfo + f; break;
     case MOD_AUTO: f = (f<10000000UL) ? bfo - f : bfo + f; break;
   }
+  return f;
+}
+
+// without regard for filters and RIT.
+void _setFrequency(Frequency f, long fine) {
+  f = loFrequency(vfos[state.vfoActive].mod, f);
   //Serial.print("LO:");
   //Serial.println(f);
-  si5351.set_freq((f * SI5351_FREQ_MULT) + fine, SI5351_CLK2);
+  synthSetFreq(SI5351_CLK2, f, fine);
+  EVENT(EV_VFO, f);
+  #if HAVE_LATENCY
+  latEnd(LAT_TUNE);
+  #endif
 }
 void _setFrequency(Frequency f) {
   _setFrequency(f,0);
 }
 
 #if HAVE_BFO
-void setBFO(Frequency f, long fine) {
+static void applyBFO(Frequency f, long fine) {
   f+=state.bfo_trim;
   //Serial.print("BFO:");
   //Serial.println(f);
-  si5351.set_freq((f * SI5351_FREQ_MULT) + fine, BFO_OUTPUT);
-}
-void setBFO(Frequency f) {
-  setBFO(f, 0);
+  synthSetFreq(BFO_OUTPUT, f, fine);
+  EVENT(EV_BFO, f);
 }
 #endif
 
+static Frequency rxFrequency(const struct vfo *v) {
+  return v->ritOn ? v->frequency + v->rit : v->frequency;
+}
+
+// Keep the Si5351 settings for the active VFO's RX and TX and the other VFOs ready,
+// so T/R, RIT and VFO changes are just a burst write. Only changed ones are worked out again.
+// With RIT on, TX differs from RX and would change on every tuning step, so it's left to
+// freqSettle() once the tuning has stopped for TX_PREPARE_MS. With RIT off it's a copy of RX.
+#define TX_PREPARE_MS 100
+static bool freq_tx_stale=false;
+
+static void prepareTX() {
+  const struct vfo *v = &vfos[state.vfoActive];
+  synthPrepare(SLOT_TX, SI5351_CLK2, loFrequency(v->mod, v->frequency), 0);
+  freq_tx_stale=false;
+}
+
+static void freqPrepare() {
+  byte i, slot=SLOT_VFOS;
+  const struct vfo *v = &vfos[state.vfoActive];
+
+  synthPrepare(SLOT_RX, SI5351_CLK2, loFrequency(v->mod, rxFrequency(v)), 0);
+  if (!v->ritOn || inTx!=INTX_NONE) {
+     prepareTX();
+  } else {
+     freq_tx_stale=true;
+     taskIn(TASK_PREPARE, TX_PREPARE_MS);
+  }
+  for (i=0; i<VFO_COUNT; i++) {
+      if (i==state.vfoActive) continue;
+      v = &vfos[i];
+      synthPrepare(slot++, SI5351_CLK2, i<state.vfoCount ? loFrequency(v->mod, rxFrequency(v)) : 0, 0);
+  }
+}
+
 // apply filters and RIT
-void setFrequency(enum ritstate withRit){
+static void applyFrequency(enum ritstate withRit){
   Frequency f = vfos[state.vfoActive].frequency;
 
   if (withRit==RIT_AUTO) {
@@ -201,9 +251,79 @@ void setFrequency(enum ritstate withRit){
   setFilters(findBand(f));
   #endif
 
+  freqPrepare();
   _setFrequency(f);
 }
 
+/*
+ * With HAVE_LAZYTUNE setFrequency() and setBFO() only note what is wanted. freqCommit() sets the
+ * filters and the Si5351 once at the end of the pass of loop(), however many times they were called.
+ * TXon(), TXoff() and CW keying commit straight away as they can't wait.
+ */
+#if HAVE_LAZYTUNE
+static bool          freq_dirty=false;
+static enum ritstate freq_rit;
+#if HAVE_BFO
+static bool          bfo_dirty=false;
+static Frequency     bfo_next;
+static long          bfo_next_fine;
+#endif
+#endif
+
+void setFrequency(enum ritstate withRit) {
+#if HAVE_LAZYTUNE
+  freq_rit=withRit;
+  freq_dirty=true;
+#else
+  applyFrequency(withRit);
+#endif
+}
+
+#if HAVE_BFO
+void setBFO(Frequency f, long fine) {
+#if HAVE_LAZYTUNE
+  bfo_next=f;
+  bfo_next_fine=fine;
+  bfo_dirty=true;
+#else
+  applyBFO(f, fine);
+#endif
+}
+void setBFO(Frequency f) {
+  setBFO(f, 0);
+}
+#endif
+
+// Work out the TX slot left by freqPrepare() once the tuning has settled.
+static void freqSettle() {
+  if (!freq_tx_stale) return;
+  if (!taskDue(TASK_PREPARE)) return;
+  prepareTX();
+}
+
+// Set anything setFrequency() or setBFO() left waiting, BFO and VFO in one burst.
+void freqCommit() {
+#if HAVE_LAZYTUNE
+  #if HAVE_BFO
+  if (!freq_dirty && !bfo_dirty) return;
+  #else
+  if (!freq_dirty) return;
+  #endif
+  synthBegin();
+  #if HAVE_BFO
+  if (bfo_dirty) {
+     bfo_dirty=false;
+     applyBFO(bfo_next, bfo_next_fine);
+  }
+  #endif
+  if (freq_dirty) {
+     freq_dirty=false;
+     applyFrequency(freq_rit);
+  }
+  synthCommit();
+#endif
+}
+
 
 
 /**
@@ -219,7 +339,133 @@ void setFrequency(enum ritstate withRit){
  */
 #if HAVE_PTT
 
+/*
+ * The T/R sequencer switches the relays with TX_RX and times the steps, so nothing has to wait.
+ * RX -> relays on -> settle -> TX (ready), and TX -> tail -> relays off -> RX.
+ * During TX a filter change goes TX -> mute (TX_RX off) -> switch filters -> unmute -> TX.
+ * In the tail it goes tail -> mute -> switch filters -> RX.
+ * TX_RX doesn't go high, and neither TX nor the unmute happen, until the filter relays have
+ * finished switching. So a filter change started by TXon() holds the settle with TX_RX low.
+ */
+enum trstate { TR_RX, TR_SETTLE, TR_TX, TR_MUTE, TR_UNMUTE, TR_TAIL };
+static enum trstate tr_state=TR_RX;
+static bool         tr_keyed=false; // TX_RX is high
+
+static void trRelays(bool tx) {
+  digitalWrite(TX_RX, tx);
+  tr_keyed=tx;
+}
+
+static void trStart() {
+  switch (tr_state) {
+    case TR_RX:
+         tr_state=TR_SETTLE;
+         #if HAVE_FILTERS
+         if (filtersBusy()) { // trCheck() raises TX_RX once they're done
+            taskIn(TASK_TR, 1);
+            break;
+         }
+         #endif
+         trRelays(1);
+         taskIn(TASK_TR, TR_SETTLE_MS);
+         break;
+    case TR_TAIL: // the relays never left TX
+         tr_state=TR_TX;
+         break;
+    default:
+         break;
+  }
+}
+
+static void trStop() {
+  #if HAVE_FILTERS
+  filtersMuted(); // start any filter change waiting for the mute, it finishes in RX
+  #endif
+  if (tr_state==TR_TX && TR_TAIL_MS) {
+     tr_state=TR_TAIL;
+     taskIn(TASK_TR, TR_TAIL_MS);
+  } else {
+     trRelays(0);
+     tr_state=TR_RX;
+  }
+}
+
+// Turn off the RF output so the filters can be switched. false if the relays are in RX.
+// A change during the tail ends it, and the sequencer goes on to RX instead of unmuting.
+// One while the settle is held for the filters switches straight away, TX_RX is still low.
+bool trMute() {
+  switch (tr_state) {
+    case TR_SETTLE:
+         if (!tr_keyed) return false;
+         // fall through
+    case TR_TX:
+    case TR_UNMUTE:
+    case TR_TAIL:
+         trRelays(0);
+         tr_state=TR_MUTE;
+         taskIn(TASK_TR, TR_MUTE_MS);
+         return true;
+    case TR_MUTE:
+         return true;
+    default:
+         return false;
+  }
+}
+
+bool txReady() {
+  return tr_state==TR_TX;
+}
+
+void trCheck() {
+  if (tr_state==TR_RX || tr_state==TR_TX) return;
+  if (!taskDue(TASK_TR)) return;
+
+  switch (tr_state) {
+    case TR_SETTLE:
+         #if HAVE_FILTERS
+         if (filtersBusy()) {
+            taskIn(TASK_TR, 1);
+            break;
+         }
+         #endif
+         if (!tr_keyed) { // held for the filters, now they can go to TX
+            trRelays(1);
+            taskIn(TASK_TR, TR_SETTLE_MS);
+            break;
+         }
+         tr_state=TR_TX;
+         EVENT(EV_TXREADY, inTx);
+         break;
+    case TR_MUTE:
+         #if HAVE_FILTERS
+         filtersMuted();
+         if (filtersBusy()) {
+            taskIn(TASK_TR, 1);
+            break;
+         }
+         #endif
+         if (inTx==INTX_NONE) { // TX ended while muted
+            tr_state=TR_RX;
+            break;
+         }
+         tr_state=TR_UNMUTE;
+         taskNext(TASK_TR, TR_MUTE_MS);
+         break;
+    case TR_UNMUTE:
+         trRelays(1);
+         tr_state=TR_TX;
+         break;
+    case TR_TAIL:
+         trRelays(0);
+         tr_state=TR_RX;
+         break;
+    default:
+         break;
+  }
+}
+
 // Put the rig into TX mode if we are allowed on this frequency.
+// The relays are still settling when this returns, see txReady().
 bool TXon(enum txcause cause) {
   //if (inTx!=INTX_NONE) return false;
   const struct band *b=findBand(vfos[state.vfoActive].frequency);
@@ -229,23 +475,32 @@ bool TXon(enum txcause cause) {
      if (vfos[state.vfoActive].ritOn || cause==INTX_CW) {
         setFrequency(cause == INTX_CW ? RIT_CW : RIT_OFF);
      }
-     digitalWrite(TX_RX, 1);
-     //give the relays a few ms to settle the T/R relays
-     delay(30);
+     freqCommit(); // on the TX frequency and filter before the relays switch
+     trStart();
+     EVENT(EV_TXON, cause);
+     #if HAVE_LATENCY
+     latEnd(LAT_PTT);
+     #endif
      return true;
   } else {
      inTx=INTX_DIS;
+     EVENT(EV_TXDIS, cause);
      updateDisplay();
      return false;
   }
 }
 
 void TXoff() {
+  #if HAVE_EVENTLOG
+  enum txcause cause = inTx;
+  #endif
   inTx = INTX_NONE;
   if (vfos[state.vfoActive].ritOn || inTx==INTX_CW) {
      setFrequency(RIT_ON); // return to listen frequency
   }
-  digitalWrite(TX_RX, 0);
+  freqCommit();
+  trStop();
+  EVENT(EV_TXOFF, cause);
   #if HAVE_BFO
   if (inTx==INTX_CW) setBFO(bfo_freq);
   #endif
@@ -260,11 +515,30 @@ void checkTX(){
   if (cwTimeout > 0)
     return;
     
-  register char ptt=digitalRead(PTT);
+  #if HAVE_PCINT
+  register char ptt = pcintLevel(PC_PTT) ? 0 : 1;
+  #else
+  register char ptt=DIGITAL_READ(PTT);
+  #endif
+  #if HAVE_LATENCY && !HAVE_PCINT
+  static unsigned long ptt_idle=0;
+  #endif
+
   // make TX_RX reflect PTT input
   if (ptt == 0 && inTx == INTX_NONE){
+     #if HAVE_LATENCY && HAVE_PCINT
+     if (pcintChanged(PC_PTT)) latStart(LAT_PTT, pcintTime(PC_PTT));
+     #elif HAVE_LATENCY
+     if (ptt_idle) latStart(LAT_PTT, ptt_idle); // not if PTT has been held since boot
+     #endif
      TXon(INTX_PTT);
+     #if HAVE_LATENCY
+     latCancel(LAT_PTT); // in case TX was disabled and TX_RX never went high
+     #endif
   }
+  #if HAVE_LATENCY && !HAVE_PCINT
+  if (ptt == 1) ptt_idle=micros();
+  #endif
 	
   if (ptt == 1 && inTx!=INTX_NONE){
      TXoff();
@@ -277,85 +551,68 @@ void checkTX(){
  * A click on the function button toggles the RIT
  * A double click selects the next VFO
  * A long press copies both the VFOs to the same frequency or activates the menu if enabled.
+ * Turning the tuning knob while the button is down does a coarse bandset, 100 Khz per step.
  */
 void checkButton(){
-  int knob, new_knob;
-  unsigned long t1, duration=0;
-  
-  //rest of this function is interesting only if the button is pressed
-  if (!btnDown())
-    return;
-    
-  // note the time of the button going down and where the tuning knob was
-  t1 = millis();
-  knob = analogRead(ANALOG_TUNING);
-  
-  // if you move the tuning knob within 3 seconds (3000 milliseconds) of pushing the button down
-  // then consider it to be a coarse tuning where you you can move by 100 Khz in each step
-  // This is useful only for multiband operation.
-  while (btnDown() && (duration=(millis()-t1)) < 3000){
-  
-      new_knob = analogRead(ANALOG_TUNING);
-      //has the tuninng knob moved while the button was down from its initial position?
-      if (abs(new_knob - knob) > 10){
-        /* track the tuning and return */
-        while (btnDown()){
-          vfos[state.vfoActive].frequency = baseTune = ((analogRead(ANALOG_TUNING) * 30000l) + 1000000l);
-          setFrequency(RIT_ON);
-          updateDisplay();
-          delay(200);
-        }
-        waitBtnUp();
-        return;
-      } /* end of handling the bandset */
-      
-     delay(100);
-  }
-
-  //we reach here only upon the button being released
-
-  // if the button has been down for more than TAP_HOLD_MILLIS, we consider it a long press
-  // set all VFOs to the same frequency, update the display and be done
-  // or if HAVE_MENU activate the menu mode
-  if (duration > TAP_HOLD_MILLIS){
-#if HAVE_MENU
-    showMenuItem();
-    mode = MODE_MENU;
-    waitBtnUp();
-#else
-    sync_vfos();
-    printLine2(F("VFOs Reset!"));
-#endif
-    delay(300);
-    //updateDisplay();
-    return;    
-  }
+  static bool bandset=false;
+  static unsigned long bandset_last=0;
+
+  switch (btnEvent()) {
+    case BTN_NONE:
+         break;
 
-  //now wait for another click
-  delay(100);
-  // if there a second button press, toggle the VFOs
-  if (btnDown()){
+    case BTN_TAP:
+         //on a single tap, toggle the RIT
+         vfos[state.vfoActive].ritOn = vfos[state.vfoActive].ritOn ? false : true;
+         setFrequency(RIT_ON);
+         updateDisplay();
+         break;
 
-     //Change to next VFO on double tap
-     state.vfoActive++;
-     if (state.vfoActive >= state.vfoCount) state.vfoActive=0;
+    case BTN_DOUBLE:
+         //Change to next VFO on double tap
+         state.vfoActive++;
+         if (state.vfoActive >= state.vfoCount) state.vfoActive=0;
+         setFrequency(RIT_ON);
 
-     // If we don't have a menu, also store the VFO defaults... if we have that.
+         // If we don't have a menu, also store the VFO defaults... if we have that.
 #if !HAVE_MENU
 #if HAVE_SAVESTATE
-     put_state();
-     put_vfos();
+         put_state();
+         put_vfos();
 #endif
 #endif
-     updateDisplay();
+         updateDisplay();
+         break;
+
+    case BTN_HOLD:
+         // set all VFOs to the same frequency, update the display and be done
+         // or if HAVE_MENU activate the menu mode
+#if HAVE_MENU
+         showMenuItem();
+         mode = MODE_MENU;
+#else
+         sync_vfos();
+         printLine2(F("VFOs Reset!"));
+#endif
+         break;
+
+    case BTN_TURN:
+         // This is useful only for multiband operation.
+         bandset=true;
+         bandset_last=0;
+         break;
+  }
+
+  // track the tuning knob until the button is released
+  if (bandset) {
+     if (!btnHeld()) {
+        bandset=false;
+     } else if (interval(&bandset_last, 200)) {
+        vfos[state.vfoActive].frequency = baseTune = ((knobPos() * 30000l) + 1000000l);
+        setFrequency(RIT_ON);
+        updateDisplay();
+     }
   }
-  // No, there was not more taps
-  else {
-    //on a single tap, toggle the RIT
-    vfos[state.vfoActive].ritOn = vfos[state.vfoActive].ritOn ? false : true;
-    updateDisplay();
-  }    
-  waitBtnUp();
 }
 
 /**
@@ -369,31 +626,61 @@ void checkButton(){
 
 
 void doTuning(){
- static unsigned long last=0;
- static unsigned int stepdelay=0;
- if (!interval(&last, stepdelay)) return;
- 
+ #if HAVE_LATENCY
+ static unsigned long lat_idle=0;
+ #endif
+#if HAVE_ENCODER
+ // The encoder is counted by interrupts, so just take whatever has turned since last time.
+ unsigned long period;
+ int detents = encoderRead(period);
+
  // never let the tuning move during TX
  if (inTx!=INTX_NONE) return;
 
- int knob = analogRead(ANALOG_TUNING)-10;
+ Frequency frequency = vfos[state.vfoActive].frequency;
+ long step = ENCODER_STEP;
+ if      (period < 1000000UL/ENCODER_FAST2) step *= 100;
+ else if (period < 1000000UL/ENCODER_FAST1) step *= 10;
+ frequency += detents * step;
+
+#else
+ unsigned int stepdelay;
+ if (!taskDue(TASK_TUNING)) return;
+ 
+ // never let the tuning move during TX, and the knob belongs to checkButton() while the button is down.
+ if (inTx!=INTX_NONE || btnHeld()) return;
+
+ int knob = knobPos()-10;
  Frequency frequency = vfos[state.vfoActive].frequency;
  
 #if HAVE_SHUTTLETUNE
 
+  // Turning the knob past the dead band sets a tuning rate, SHUTTLE_MIN_RATE Hz/s at the edge
+  // doubling every SHUTTLE_DOUBLE counts. It is applied every SHUTTLE_TICK, with the fractions
+  // of a Hz kept in mHz for the next tick so slow rates still move.
+  static long shuttle_mhz=0;
   int delta=0;
   if (knob < 400) {
      delta=400-knob;
-     frequency -= pow10((delta/120)+3);
   } else if (knob > 600) {
      delta=knob-600;
-     frequency += pow10((delta/120)+3);
   }
+  // Swinging the knob back towards the middle means we're there, so stop rather than overshoot.
+  if (knob < 400 ? knobVelocity() > SHUTTLE_RETURN : knobVelocity() < -SHUTTLE_RETURN) delta=0;
   if (delta) {
-     stepdelay = 400 - ((int)((delta % 120)/30) * 100);
+     unsigned long rate = (unsigned long)SHUTTLE_MIN_RATE << (delta/SHUTTLE_DOUBLE);
+     rate += rate * (delta%SHUTTLE_DOUBLE) / SHUTTLE_DOUBLE;
+     if (rate > SHUTTLE_MAX_RATE) rate = SHUTTLE_MAX_RATE;
+
+     shuttle_mhz += (long)rate * SHUTTLE_TICK;
+     long hz = shuttle_mhz / 1000;
+     shuttle_mhz -= hz * 1000;
+     if (knob < 400) frequency -= hz;
+     else            frequency += hz;
   } else {
-     stepdelay=400;
+     shuttle_mhz=0;
   }
+  stepdelay=SHUTTLE_TICK;
 #else // original tuning  
   
   stepdelay=200;
@@ -411,12 +698,18 @@ void doTuning(){
   else if (knob != old_knob){
      frequency = baseTune + (50l * knob);
      old_knob = knob;
-     stepdelay=0;
+     stepdelay=SCHED_POLL; // keep following the knob
   }
 #endif
+  taskNext(TASK_TUNING, stepdelay);
+#endif // HAVE_ENCODER
 
   // if the frequency was changed, update things
   if (frequency != vfos[state.vfoActive].frequency) {
+     #if HAVE_LATENCY
+     if (lat_idle) latStart(LAT_TUNE, lat_idle);
+     lat_idle=0;
+     #endif
      #if TUNE_BANDS_ONLY
        frequency = findNextBandFreq(frequency);
      #endif
@@ -424,15 +717,18 @@ void doTuning(){
      setFrequency(RIT_ON);
      updateDisplay();
   }
+  #if HAVE_LATENCY
+  else lat_idle=micros();
+  #endif
 }
 
 
 #if HAVE_CHANNELS
 void doChannel() {
-  static unsigned long last=0;
-  if (!interval(&last, 400)) return;
+  if (!taskDue(TASK_TUNING)) return;
+  taskNext(TASK_TUNING, 400);
   
-  int knob = analogRead(ANALOG_TUNING) - 10;
+  int knob = knobPos() - 10;
   unsigned char c=state.channelActive;
   if (knob < 400) {
      if (c>0) c--; else c=state.channelCount-1;
@@ -463,26 +759,56 @@ void doChannel() {
 static const char S_VERSION[] PROGMEM = "BitXUltra 1.0";
 static const char S_AUTHOR [] PROGMEM = "  by VK6MN   ";
 
+#if HAVE_FASTBOOT
+/*
+ * A warm boot (watchdog, brown-out or reset button, or RAM still holding our magic number from
+ * the last run) skips the splash screen, the pauses and the bleeps to get back on air quickly.
+ * .noinit RAM isn't cleared at startup, so it survives anything but a power cycle.
+ */
+#define BOOT_MAGIC 0xB17C0DE5UL
+static unsigned long boot_magic __attribute__((section(".noinit")));
+static byte          boot_mcusr __attribute__((section(".noinit")));
+
+// Runs before main(). Save and clear the reset cause, and stop the watchdog in case it was the cause
+// as it stays running after a watchdog reset.
+void boot_early() __attribute__((naked, used, section(".init3")));
+void boot_early() {
+  boot_mcusr = MCUSR;
+  MCUSR = 0;
+  wdt_disable();
+}
+#endif
+
 void setup()
 {
   int32_t cal;
+#if HAVE_FASTBOOT
+  const bool warm = (boot_magic == BOOT_MAGIC) ||
+                    ((boot_mcusr & (_BV(WDRF) | _BV(BORF) | _BV(EXTRF))) && !(boot_mcusr & _BV(PORF)));
+  boot_magic = BOOT_MAGIC;
+#else
+  const bool warm = false;
+#endif
   
-#if HAVE_PULSE
+#if HAVE_PULSE || HAVE_MEMSTATS
   setupStackCanary();
 #endif
   
   initDisplay();
 
-  printLine1(FH(S_VERSION));
-  printLine2(FH(S_AUTHOR));
-  
   // Start serial and initialize the Si5351
   Serial.begin(9600);
   analogReference(DEFAULT);
-  Serial.print(F("*"));
-  Serial.println(FH(S_VERSION));
-  Serial.print(F("* by "));
-  Serial.println(FH(S_AUTHOR));
+  if (warm) {
+     Serial.println(F("*Warm boot"));
+  } else {
+     printLine1(FH(S_VERSION));
+     printLine2(FH(S_AUTHOR));
+     Serial.print(F("*"));
+     Serial.println(FH(S_VERSION));
+     Serial.print(F("* by "));
+     Serial.println(FH(S_AUTHOR));
+  }
   
   //configure the function button to use the external pull-up
   pinMode(FBUTTON, INPUT_PULLUP);
@@ -505,6 +831,11 @@ void setup()
   digitalWrite(CW_TONE, LOW);
 #endif
 
+#if HAVE_PCINT
+  pcintSetup();
+#endif
+  knobPoll(); // first reading
+
 #ifdef FILTER_PIN0
   pinMode(FILTER_PIN0, OUTPUT);
 #endif
@@ -528,7 +859,7 @@ void setup()
 #if HAVE_SAVESTATE
   get_state();
   if (state.magic == STATE_MAGIC) {
-     Serial.println(F("*Reading Config"));
+     if (!warm) Serial.println(F("*Reading Config"));
      get_vfos();
   } else
 #endif  
@@ -538,7 +869,7 @@ void setup()
     init_state();
   }
 
-  Serial.println(F("*Initialize Si5351"));
+  if (!warm) Serial.println(F("*Initialize Si5351"));
 
   si5351.set_pll(SI5351_PLL_FIXED, SI5351_PLLA);
   si5351.set_pll(SI5351_PLL_FIXED, SI5351_PLLB);
@@ -547,17 +878,23 @@ void setup()
   si5351.output_enable(SI5351_CLK1, 0);
   si5351.output_enable(SI5351_CLK2, 1);
 //  si5351.set_freq(5000000ULL * SI5351_FREQ_MULT,  SI5351_CLK2);   
+#if HAVE_FASTBOOT
+  synthRestore(warm);
+#endif
 
 #if HAVE_BFO
   setBFO(bfo_freq);
-  si5351.output_enable(BFO_OUTPUT, 1);
+  freqCommit(); // the library powers the output up the first time it's set, before it's enabled
+  synthEnable(BFO_OUTPUT, 1); // through the shadow, which a warm boot has just restored
 #endif
-  Serial.println(F("*Si5351 ON"));
   mode = MODE_NORMAL;
-  delay(10);
+  if (!warm) {
+     Serial.println(F("*Si5351 ON"));
+     delay(10);
+  }
 
 #if HAVE_MENU
-  // Holding FBUTTON at power-on will reset the config
+  // Holding FBUTTON at power-on will reset the config, even on a warm boot
   if (btnDown()) {
     init_state();
     printLine2(F("  Clear Config  "));
@@ -574,6 +911,12 @@ void setup()
     setFrequency(RIT_ON);
   }
 #endif
+  freqCommit();
+
+  if (warm) {
+     updateDisplay();
+     return;
+  }
 
   // so the user gets to read whetever is on the display
   holdLine2(1000);
@@ -584,25 +927,23 @@ void setup()
 }
 
 
-#if HAVE_CW_BEACON || HAVE_FSQ_BEACON
-unsigned long last_beacon_start=0;
-#endif
+void loop(){
 
+  PROF_MARK(PROF_SERIAL); // serialEvent() runs between passes of loop()
 
-void loop(){
+#if HAVE_EVENTLOG
+  // mode is changed in many places, so just watch for the change here.
+  static enum modes ev_mode=MODE_NORMAL;
+  if (mode!=ev_mode) {
+     ev_mode=mode;
+     EVENT(EV_MODE, mode);
+  }
+#endif
 
-#if 0
-  // some test code to see how often loop() runs.
+#if HAVE_LOOPSTATS
+  // see how often loop() runs and how long each pass takes.
   // basically checks to see if something is using delay significantly.
-  static unsigned long counter=0;
-  static unsigned long etime=0;
-  counter++;
-  if ((millis()-etime) > 1000) {
-     sprintf(c,"%ld loops in %ld millis", counter, millis()-etime);
-     Serial.println(c);
-     etime=millis();
-     counter=0;
-  }
+  loopStats();
 #endif
 
 #if HAVE_PULSE
@@ -621,24 +962,46 @@ void loop(){
         minfree=freespace;
      }
   }
+  PROF_MARK(PROF_OTHER);
+#endif
+
+#if HAVE_PCINT
+  pcintPoll();
+  PROF_MARK(PROF_TX);
+#endif
+
+#if HAVE_FILTERS
+  filtersCheck();
+  PROF_MARK(PROF_TX);
 #endif
 
 #if HAVE_PTT
+  trCheck();
+  PROF_MARK(PROF_TX);
   if (inTx != INTX_ANA && inTx != INTX_CAT) {
      #if HAVE_CW
        checkCW();
+       PROF_MARK(PROF_CW);
      #endif
      checkTX();
+     PROF_MARK(PROF_TX);
   }
 #endif
 
   checkLine2Hold(); // clears line 2 if something else hasn't done it already.
+  PROF_MARK(PROF_LINE2);
   bleep_check();
+  PROF_MARK(PROF_BLEEP);
+  knobPoll();
+  PROF_MARK(PROF_TUNING);
+  btnPoll();
+  PROF_MARK(PROF_BUTTON);
   
   switch (mode) {
     case MODE_NORMAL:
          #if HAVE_SWR || HAVE_SMETER
             doMeters();
+            PROF_MARK(PROF_METERS);
          #endif
          #if HAVE_CHANNELS
             if (!state.useVFO)
@@ -646,20 +1009,24 @@ void loop(){
             else
          #endif
             doTuning();
+         PROF_MARK(PROF_TUNING);
 
          // checkButton is last so the display isn't overwritten after a mode change.
          checkButton();
+         PROF_MARK(PROF_BUTTON);
          break;
 
 #if !NEW_CAL
     case MODE_CALIBRATE:
          calibrate();
+         PROF_MARK(PROF_OTHER);
          break;
 #endif
 
 #if HAVE_MENU
     case MODE_MENU:
          checkMenu();
+         PROF_MARK(PROF_MENU);
          break;
     case MODE_ADJUSTMENT: 
          // Generic adjustment mode - handles all settings with callbacks in menu.cpp.
@@ -668,45 +1035,49 @@ void loop(){
             case ADJ_SET:
                  break;
          }
+         PROF_MARK(PROF_MENU);
          break;
 
 #if HAVE_CW_BEACON
     case MODE_CWBEACON:
-         if (btnDown()) {
+         if (btnEvent()) {
             mode=MODE_NORMAL;
-            last_beacon_start=0;
+            taskNow(TASK_BEACON); // start straight away next time
             send_cw_flush();
             printLine2(F("  Beacon Off    "));
             holdLine2(500);
-            waitBtnUp();
-         } else if (interval(&last_beacon_start, (unsigned long)state.cw_beacon_interval * 1000UL)) {
+         } else if (taskDue(TASK_BEACON)) {
+            taskNext(TASK_BEACON, (unsigned long)state.cw_beacon_interval * 1000UL);
             // copy the beacon string into the send buffer
             send_cw_string(EH(CWBEACON_EEPROM_START), CWBEACON_MAXLEN);
             printLine2(S_CWBEACON);
          }
+         PROF_MARK(PROF_OTHER);
          break;
 #endif // HAVE_CW_BEACON
 
 #if HAVE_FSQ_BEACON
     case MODE_FSQBEACON:
-         if (btnDown()) {
+         if (btnEvent()) {
             mode=MODE_NORMAL;
-            last_beacon_start=0;
+            taskNow(TASK_BEACON); // start straight away next time
             printLine2(F("  Beacon Off    "));
             holdLine2(500);
-            waitBtnUp();
-         } else if (interval(&last_beacon_start, (unsigned long)state.cw_beacon_interval * 1000UL)) {
+         } else if (taskDue(TASK_BEACON)) {
+            taskNext(TASK_BEACON, (unsigned long)state.cw_beacon_interval * 1000UL);
             printLine2(S_FSQBEACON);
             start_fsq_tx();
          } else {
             do_fsq_tx();
          }
+         PROF_MARK(PROF_OTHER);
          break;
 #endif // HAVE_CW_BEACON
 
 #if HAVE_ANALYSER
     case MODE_ANALYSER:
          doAnalyser();
+         PROF_MARK(PROF_OTHER);
          break;
 #endif // HAVE_ANALYSER
 
@@ -715,6 +1086,12 @@ void loop(){
          mode=MODE_NORMAL;
   }
 
-  delay(5);
+  freqCommit();
+  freqSettle();
+  PROF_MARK(PROF_TUNING);
+
+  // wait for the next thing that needs doing.
+  schedWait();
+  PROF_MARK(PROF_DELAY);
 }
 
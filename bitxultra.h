@@ -213,6 +213,11 @@ extern const struct band * findBand(Frequency f);
 extern Frequency findNextBandFreq(Frequency f);
 #if HAVE_FILTERS
 extern void setFilters(const struct band *band);
+extern void filtersCheck();
+extern bool filtersBusy();
+#if HAVE_PTT
+extern void filtersMuted();
+#endif
 #endif
 
 // fsq.cpp
@@ -249,8 +254,14 @@ extern void setFrequency(enum ritstate);
 extern void setBFO(Frequency f, long fine);
 extern void setBFO(Frequency f);
 #endif
+extern void freqCommit();
 extern bool TXon(enum txcause cause);
 extern void TXoff();
+#if HAVE_PTT
+extern bool trMute();
+extern bool txReady();
+extern void trCheck();
+#endif
 
 
 // utils.cpp
@@ -276,14 +287,37 @@ extern void get_calibration(int32_t &);
 extern void put_calibration(int32_t);
 extern void put_beacon_text(const char *);
 extern void print_beacon_text();
-extern byte getEEPROMByte(unsigned int addr);
+extern byte getEEPROMByte(uintptr_t addr);
 extern unsigned long pow10(unsigned int x);
 extern bool interval(unsigned long *last, unsigned int limit);
+
+// The tasks run from loop() on a deadline. Tasks that are never active at the same time can share one.
+enum task { TASK_TUNING, TASK_METERS, TASK_CW, TASK_MENU, TASK_ADJUST, TASK_BLEEP, TASK_BEACON, TASK_TR, TASK_KNOB, TASK_FILTER, TASK_PREPARE, TASK_COUNT };
+#define SCHED_POLL 5 // ms, longest loop() will wait for a deadline
+extern void schedAt(unsigned long when);
+extern bool taskDue(enum task t);
+extern void taskNext(enum task t, unsigned long ms);
+extern void taskIn(enum task t, unsigned long ms);
+extern void taskNow(enum task t);
+extern void schedWait();
+#if HAVE_SLEEP
+extern void sleepStats(unsigned long &asleep, unsigned long &awake);
+#endif
 extern void bleep(unsigned int freq, unsigned int duration);
 extern void bleeps(unsigned int freq, unsigned int duration, byte count, unsigned int gap);
 extern void bleep_check();
 extern bool btnDown();
-extern int waitBtnUp();
+enum btnevent { BTN_NONE, BTN_TAP, BTN_DOUBLE, BTN_HOLD, BTN_TURN };
+#define BTN_DEBOUNCE 40 // ms
+extern void btnPoll();
+extern enum btnevent btnEvent();
+extern bool btnHeld();
+#define KNOB_SAMPLE     5 // ms between readings of the tuning pot
+#define KNOB_OVERSAMPLE 4 // ADC conversions averaged for each reading
+#define KNOB_HYSTERESIS 2 // the position only follows a reading further away than this
+extern void knobPoll();
+extern int  knobPos();
+extern int  knobVelocity();
 
 #if HAVE_SAVESTATE
 extern void put_vfos();
@@ -292,10 +326,147 @@ extern void put_state();
 extern void get_state();
 #endif
 
-#if HAVE_PULSE
+#if HAVE_PULSE || HAVE_MEMSTATS
 extern void setupStackCanary();
 extern uint16_t getMinFreeSpace();
 #endif
+#if HAVE_MEMSTATS
+extern uint16_t getStackLow();
+extern uint16_t getHeapEnd();
+#endif
+
+// stats.cpp
+#if HAVE_LOOPSTATS
+extern void loopStats();
+#endif
+
+#if HAVE_BENCH
+// Time BENCH_RUNS runs of stmt and report the time for each run to Serial.
+// Store results in bench_sink so the compiler can't throw the work away.
+// BENCH_I() names the run counter i, for a stmt that varies from run to run.
+#define BENCH_RUNS 100
+#define BENCH_I(name, i, stmt) { \
+    unsigned long _t=micros(); \
+    for (byte i=0; i<BENCH_RUNS; i++) { stmt; } \
+    benchReport(PSTR(name), micros()-_t); \
+  }
+#define BENCH(name, stmt) BENCH_I(name, _i, stmt)
+extern volatile long bench_sink;
+extern void benchReport(PGM_P name, unsigned long us);
+extern void runBenchmarks();
+#if HAVE_SWR || HAVE_SMETER
+extern void bench_meters(); // meters.cpp
+#endif
+#if HAVE_CW_SENDER
+extern void bench_cw();     // cw.cpp
+#endif
+#endif
+
+#if HAVE_LATENCY
+enum latprobe { LAT_TUNE, LAT_PTT, LAT_CAT, LAT_COUNT };
+extern void latStart(enum latprobe probe, unsigned long start);
+extern void latEnd(enum latprobe probe);
+extern void latCancel(enum latprobe probe);
+extern void latReport();
+#endif
+
+// Wrap an I2C access so its transactions, bytes and time are counted against a user of the bus.
+enum i2cuser { I2C_VFO, I2C_BFO, I2C_KEY, I2C_FILTER, I2C_COUNT };
+#if HAVE_I2CSTATS
+#define I2C_ACCOUNT(who, txns, bytes, ...) { \
+    unsigned long _t=micros(); \
+    __VA_ARGS__; \
+    i2cAccount(who, txns, bytes, _t); \
+  }
+extern void i2cAccount(enum i2cuser who, byte txns, byte bytes, unsigned long start);
+extern void i2cCount(enum i2cuser who, byte txns, byte bytes, unsigned long us);
+extern void i2cReport();
+#else
+#define I2C_ACCOUNT(who, txns, bytes, ...) __VA_ARGS__
+#endif
+
+// Profile the stages of loop(). Each PROF_MARK() charges the time (HAVE_PROFILE) and
+// the deepest stack (HAVE_MEMSTATS) since the previous mark to stage.
+#if HAVE_PROFILE || HAVE_MEMSTATS
+enum profstage { PROF_CW, PROF_TX, PROF_LINE2, PROF_BLEEP, PROF_METERS, PROF_TUNING, PROF_BUTTON,
+                 PROF_MENU, PROF_OTHER, PROF_DELAY, PROF_SERIAL, PROF_COUNT };
+#define PROF_MARK(stage) profMark(stage)
+extern void profMark(enum profstage stage);
+#else
+#define PROF_MARK(stage)
+#endif
+#if HAVE_PROFILE
+extern void profReport();
+#endif
+
+#if HAVE_MEMSTATS
+// RAM owned by each subsystem. Defined by the module that owns it.
+extern const unsigned int mem_main;     // BitXUltra.ino
+extern const unsigned int mem_display;  // display.cpp
+extern const unsigned int mem_bleep;    // utils.cpp
+extern const unsigned int mem_serial;   // remote.cpp
+#if HAVE_SWR || HAVE_SMETER
+extern const unsigned int mem_meters;   // meters.cpp
+#endif
+#if HAVE_CW_SENDER
+extern const unsigned int mem_cw;       // cw.cpp
+#endif
+#if HAVE_FSQ_BEACON
+extern const unsigned int mem_fsq;      // fsq.cpp
+#endif
+extern void memReport();
+#endif
+
+// Event trace. Each EVENT() is stored with its micros() time in a ring buffer.
+#if HAVE_EVENTLOG
+enum evtype { EV_TXON, EV_TXREADY, EV_TXOFF, EV_TXDIS, EV_FILTER, EV_VFO, EV_BFO, EV_MODE, EV_KEY, EV_COUNT };
+#define EVENT(type, arg) evLog(type, arg)
+extern void evLog(enum evtype type, long arg);
+extern void evDump();
+#else
+#define EVENT(type, arg)
+#endif
+
+// Input trace. Inputs are read through ANALOG_READ() and DIGITAL_READ() so each change can be traced.
+#if HAVE_TRACE
+#define ANALOG_READ(pin)  traceAnalogRead(pin)
+#define DIGITAL_READ(pin) traceDigitalRead(pin)
+extern int traceAnalogRead(byte pin);
+extern int traceDigitalRead(byte pin);
+extern void tracePin(unsigned long t, byte pin, int level);
+extern void traceRx(unsigned long t, const char *line);
+#else
+#define ANALOG_READ(pin)  analogRead(pin)
+#define DIGITAL_READ(pin) digitalRead(pin)
+#endif
+
+// synth.cpp
+extern void synthSetFreq(enum si5351_clock clk, Frequency f, long fine);
+extern void synthDrive(enum si5351_clock clk, enum si5351_drive drive);
+extern void synthEnable(enum si5351_clock clk, bool on);
+extern void synthBegin();
+extern void synthCommit();
+#if HAVE_FASTBOOT
+extern void synthRestore(bool warm);
+#endif
+// Slots of precomputed Si5351 settings, see freqPrepare()
+enum { SLOT_RX, SLOT_TX, SLOT_VFOS, SYNTH_SLOTS=SLOT_VFOS+VFO_COUNT-1 };
+extern void synthPrepare(byte slot, enum si5351_clock clk, Frequency f, long fine);
+
+// pcint.cpp
+#if HAVE_PCINT
+enum pcinput { PC_PTT, PC_BUTTON, PC_COUNT };
+#define PTT_DEBOUNCE 5 // ms
+extern void pcintSetup();
+extern void pcintPoll();
+extern bool pcintPending();
+extern bool pcintLevel(enum pcinput in);
+extern bool pcintChanged(enum pcinput in);
+extern unsigned long pcintTime(enum pcinput in);
+#if HAVE_ENCODER
+extern int encoderRead(unsigned long &period);
+#endif
+#endif
 
 // display.cpp
 extern void initDisplay();
@@ -309,6 +480,7 @@ extern void printLine2(const __FlashStringHelper *ifsh);
 extern void holdLine2(unsigned long ms);
 extern void checkLine2Hold();
 extern void miniMeter(const char c);
+extern void formatDisplay();
 extern void updateDisplay();
 
 #endif // BITXULTRA_H
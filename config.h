@@ -21,6 +21,18 @@
 // _CHANNELS: a channel mode. Requires HAVE_MENU.
 // _FILTERS: extra filters are available. Set the control method below.
 // _PULSE: flash the onboard LED when the main loop is running. Also enables minimum free memory reports to Serial.
+// _LOOPSTATS: report loop() iterations per second and the min/avg/max time of each pass to Serial once a second.
+// _SLEEP: idle the CPU while waiting for the next thing to do in loop(). Saves power and digital noise.
+//         CAT command "sleep" reports the time asleep and awake.
+// _PCINT: catch PTT and function button changes with pin change interrupts, so they are timed and debounced
+//         on the edges rather than on when loop() happens to look.
+// _LAZYTUNE: setFrequency() and setBFO() only note the change. The filters and Si5351 are set once at the
+//         end of each pass of loop(), so several changes in one pass cost one commit.
+//         HAVE_I2CSTATS still counts each clock's bytes of a commit under vfo or bfo, so compare it on and off.
+// _ENCODER: tune with a rotary encoder on ENCODER_A/ENCODER_B instead of the tuning pot. The faster it turns
+//         the bigger the steps. The pot is still used by the menus. Requires HAVE_PCINT.
+// _FASTBOOT: after a watchdog, brown-out or reset-button restart skip the splash screen, pauses and bleeps
+//         and go straight back to the saved state.
 #define HAVE_PTT          1
 #define HAVE_SWR          1
 #define HAVE_SHUTTLETUNE  1
@@ -28,7 +40,13 @@
 #define HAVE_MENU         1
 #define HAVE_CHANNELS     1
 #define HAVE_FILTERS      1
+//#define HAVE_PCINT        1
+//#define HAVE_SLEEP        1
+//#define HAVE_FASTBOOT     1
+//#define HAVE_LAZYTUNE     1
 //#define HAVE_PULSE        1
+//#define HAVE_LOOPSTATS    1
+//#define HAVE_ENCODER      1
 
 // 0 = Standard Fixed BFO (default). VFO is adjusted for CW TX.
 // 1 = DDS BFO on clk set by BFO_OUTPUT. BFO is moved into the crystal filter passband for CW TX. Enables BFO-Trim menu.
@@ -99,6 +117,43 @@
 // Adds about 4% to program and 2% to dynamic memory.
 #define HAVE_ANALYSER 1
 
+// Benchmarks of the frequently called routines (S-meter, SWR, CW encoding, band lookup, display formatting).
+// CAT command "bench" runs each one a number of times and reports ns per call and the equivalent CPU cycles.
+// Only useful for development. Requires HAVE_CAT.
+//#define HAVE_BENCH 1
+
+// Latency measurements: knob movement to VFO change, PTT to TX_RX and CAT "freq" to OK.
+// CAT command "lat" reports count and min/avg/max (us) for each, then clears them.
+// Start times are the last time the input was seen idle, so the figures include the polling delay.
+// They vary from run to run with what the operator did: for figures that repeat, replay a HAVE_TRACE trace in sim/.
+// Only useful for development. Requires HAVE_CAT.
+//#define HAVE_LATENCY 1
+
+// I2C bus accounting: transactions, bytes and bus time for each user of the bus
+// (VFO and BFO frequency changes, CW keying, filter switching).
+// CAT command "i2c" reports and clears the counters. Requires HAVE_CAT.
+//#define HAVE_I2CSTATS 1
+
+// Profile the time spent in each stage of loop() (keyer, PTT, meters, tuning, button, menu, serial...).
+// CAT command "prof" reports count, min/avg/max (us) and a histogram of times for each stage, then clears them.
+// Histogram buckets are <100us, <1ms, <5ms, <20ms and longer. Requires HAVE_CAT.
+//#define HAVE_PROFILE 1
+
+// RAM usage: static RAM owned by each subsystem, and the deepest the stack has been in each stage of loop().
+// Scans and marks the free stack around one stage in each pass, so costs some time each loop.
+// CAT command "mem" reports it. Requires HAVE_CAT.
+//#define HAVE_MEMSTATS 1
+
+// Event trace: the last 32 TX on/off (with cause), TX refused, filter switches, VFO/BFO frequency
+// commits, mode changes and CW key up/down, each with its time in us. Uses 288 bytes of RAM.
+// CAT command "ev" dumps it, oldest first. Requires HAVE_CAT.
+//#define HAVE_EVENTLOG 1
+
+// Input trace: every change of the tuning pot, keyer, meters, PTT and function button, and every line
+// received, is sent to Serial as a TR: line with its time in us. Save the serial output and replay it
+// with sim/bitxsim -r to measure loop() timing and latency for a real session, the same every time.
+//#define HAVE_TRACE 1
+
 
 #endif // Config/Minimal
 
@@ -163,6 +218,20 @@
 #define CW_TONE (6)
 #define CW_KEY (5)
 
+/**
+ * Rotary encoder (HAVE_ENCODER) on the spare D3 and D4, common to ground. Uses the internal pullups.
+ * Direct filter control can't use FILTER_PIN0/1 on the same pins.
+ * ENCODER_QUARTERS : quadrature steps per detent, 4 for most encoders, 2 for some.
+ * ENCODER_STEP : Hz per detent turning slowly. 10x that above ENCODER_FAST1 detents per second,
+ *                100x above ENCODER_FAST2.
+ */
+#define ENCODER_A (3)
+#define ENCODER_B (4)
+#define ENCODER_QUARTERS 4
+#define ENCODER_STEP  10
+#define ENCODER_FAST1 10
+#define ENCODER_FAST2 40
+
 #if HAVE_FILTERS
 // Extra filter settings. No need for any of these if you only have the standard 40m filters on the board.
 // How to set the filters for each band is defined in txbands around line 45 of filters.cpp
@@ -196,12 +265,26 @@
 #define FILTER_CONTROL setFilters_IO
 #endif
 
+// How long latching relays are powered for to switch, if FILTER_RELAYS_OFF is defined.
+#if FILTER_I2C
+#define FILTER_PULSE_MS (20)
+#else
+#define FILTER_PULSE_MS (30)
+#endif
+
 // Sanity check the filter setup
 #if !FILTER_I2C
 #ifndef FILTER_PIN0
 #error Must have either FILTER_PIN0 or FILTER_I2C defined if HAVE_FILTERS is defined.
 #endif
 #endif
+#if HAVE_ENCODER
+#if (defined(FILTER_PIN0) && (FILTER_PIN0 == ENCODER_A || FILTER_PIN0 == ENCODER_B)) || \
+    (defined(FILTER_PIN1) && (FILTER_PIN1 == ENCODER_A || FILTER_PIN1 == ENCODER_B)) || \
+    (defined(FILTER_PIN2) && (FILTER_PIN2 == ENCODER_A || FILTER_PIN2 == ENCODER_B))
+#error The encoder and the filter pins overlap. Move ENCODER_A/ENCODER_B or the FILTER_PINs.
+#endif
+#endif
 
 #endif // HAVE_FILTERS
 
@@ -271,12 +354,36 @@
  *  TAP_DOWN_MILLIS : upper limit of how long a tap can be to be considered as a button_tap
  *  TAP_UP_MILLIS : upper limit of how long a gap can be between two taps of a button_double_tap
  *  TAP_HOLD_MILIS : many milliseconds of the buttonb being down before considering it to be a button_hold
+ *  SHUTTLE_TICK : milliseconds between shuttle tuning updates (HAVE_SHUTTLETUNE). Each one is a Si5351 write,
+ *                 so this is the I2C budget for tuning: 20ms is at most 50 writes a second.
+ *  SHUTTLE_MIN_RATE : Hz per second just past the dead band of the knob. Doubles every SHUTTLE_DOUBLE counts.
+ *  SHUTTLE_MAX_RATE : fastest tuning in Hz per second, SHUTTLE_MAX_RATE*SHUTTLE_TICK/1000 Hz per write.
+ *  SHUTTLE_RETURN : knob counts per second back towards the middle that stop the shuttle, so it doesn't overshoot.
+ *  CW_RAMP_US : microseconds for each drive strength step of the CW keying envelope (HAVE_BFO only)
+ *  CW_DRIVE_MAX : drive strength at the top of the envelope. SI5351_DRIVE_2MA, _4MA, _6MA or _8MA
  */
  
 #define TAP_UP_MILLIS (500)
 #define TAP_DOWN_MILLIS (600)
 #define TAP_HOLD_MILLIS (2000)
 #define CW_TIMEOUT (600l) // in milliseconds, this is the parameter that determines how long the tx will hold between cw key downs
+#define SHUTTLE_TICK (20)
+#define SHUTTLE_MIN_RATE (20)
+#define SHUTTLE_DOUBLE (30)
+#define SHUTTLE_MAX_RATE (250000l)
+#define SHUTTLE_RETURN (200)
+#define CW_RAMP_US (1000)
+#define CW_DRIVE_MAX SI5351_DRIVE_4MA
+
+/**
+ *  T/R sequencing, in milliseconds. Nothing else stops while these run, but no carrier is keyed until TX is ready.
+ *  TR_SETTLE_MS : time for the T/R relays to settle after TX_RX goes high
+ *  TR_MUTE_MS : time TX_RX is held low before and after switching filters during TX
+ *  TR_TAIL_MS : time the T/R relays are held in TX after TX ends. 0 drops them straight away.
+ */
+#define TR_SETTLE_MS (30)
+#define TR_MUTE_MS (20)
+#define TR_TAIL_MS (0)
 
 #endif
 
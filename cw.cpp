@@ -59,60 +59,132 @@ unsigned long cwTimeout = 0;
 static char keyDown = 0;
 #endif
 
+#if HAVE_BFO
+/*
+ * Keying envelope. The BFO drive strength is stepped from 2ma up to CW_DRIVE_MAX on key down,
+ * and back down on key up before the output is turned off, one step every CW_RAMP_US.
+ * The first step is taken as the key goes down or up, so with CW_DRIVE_MAX at 4ma the carrier
+ * is 2ma for CW_RAMP_US at each end, as it was with delay(1).
+ * cwEnvelope() does the rest of the steps from loop(), so keying never waits for the ramp.
+ */
+static bool              env_busy=false;
+static bool              env_up;
+static enum si5351_drive env_drive;
+static unsigned long     env_last; // micros of the last step
+
+static void cwEnvelope() {
+  if (!env_busy) return;
+  if (micros()-env_last < CW_RAMP_US) {
+     schedAt(millis()+1);
+     return;
+  }
+  env_last += CW_RAMP_US;
+
+  if (env_up) {
+     env_drive = (enum si5351_drive)(env_drive+1);
+     if (env_drive>=CW_DRIVE_MAX) env_busy=false;
+  } else if (env_drive>SI5351_DRIVE_2MA) {
+     env_drive = (enum si5351_drive)(env_drive-1);
+  } else {
+     // down to the bottom step and it has had its time, carrier off.
+     synthEnable(BFO_OUTPUT, 0);
+     digitalWrite(CW_KEY, LOW);
+     env_busy=false;
+     return;
+  }
+  synthDrive(BFO_OUTPUT, env_drive);
+  if (env_busy) schedAt(millis()+1);
+}
+#endif
+
 // Do frequency changes and TX start ready for CW TX
 void CWstart(){
+  synthBegin();
   #if HAVE_BFO
       setBFO(bfo_freq - state.sideTone);
   #else
       setFrequency(RIT_CW); // shift the VFO instead
   #endif
   TXon(INTX_CW);     // into TX mode, but no carrier yet  
+  synthCommit(); // BFO and VFO move together
 }
 
 // Return frequencies to SSB mode after CW
 void CWstop(){
-  register char ptt=digitalRead(PTT);
+  register char ptt=DIGITAL_READ(PTT);
+  synthBegin();
   #if HAVE_BFO
+      if (env_busy) { // cut any ramp short, the BFO goes back to SSB duty
+         env_busy=false;
+         digitalWrite(CW_KEY, LOW);
+      }
       setBFO(bfo_freq);
-      si5351.output_enable(BFO_OUTPUT, 1);
+      synthEnable(BFO_OUTPUT, 1);
   #else
       setFrequency(ptt ? RIT_OFF : RIT_ON);
   #endif
   if (ptt == 1){ // only return to RX if PTT is not pressed.
      TXoff();
   }
+  freqCommit();
+  synthCommit();
 }
 
+// the key went down before the T/R relays were ready, CWon() again once they are.
+static bool cw_waiting=false;
+
+
 // Turn on the carrier
 void CWon() {
+    if (!txReady()) {
+       cw_waiting=true;
+       return;
+    }
+    cw_waiting=false;
+    freqCommit(); // the carrier must come up on the right frequency
     #if HAVE_BFO
       // generate the carrier right in the crystal filter passband.
       // might even be able to use the power out control of the 5351 to slope the envelope
       // Adjusting by the sidetone freq means tuning a signal to (or near) your preferred sidetone will
       // always put your reply on (or very near) their frequency.
       // Works the same for both LSB and USB!
-      // Drive strength is ramped to help shape the envelope
-      si5351.drive_strength(BFO_OUTPUT, SI5351_DRIVE_2MA); // 2,4,6 or 8ma
-      si5351.output_enable(BFO_OUTPUT, 1);
-      digitalWrite(CW_KEY, HIGH);
-      delay(1);
-      si5351.drive_strength(BFO_OUTPUT, SI5351_DRIVE_4MA); // 2,4,6 or 8ma
+      // Drive strength is ramped by cwEnvelope() to help shape the envelope
+      if (!env_busy) { // else still ramping down from the last element, turn it around
+         env_drive = SI5351_DRIVE_2MA;
+         synthDrive(BFO_OUTPUT, env_drive);
+         synthEnable(BFO_OUTPUT, 1);
+         digitalWrite(CW_KEY, HIGH);
+         env_last = micros();
+      }
+      EVENT(EV_KEY, 1);
+      env_up   = true;
+      env_busy = env_drive < CW_DRIVE_MAX;
+      if (env_busy) schedAt(millis()+1);
     #else
       digitalWrite(CW_KEY, HIGH);
+      EVENT(EV_KEY, 1);
     #endif
     tone(CW_TONE, state.sideTone);
 }
 
 // turn off the carrier
 void CWoff() {
+    cw_waiting=false;
     #if HAVE_BFO
-      si5351.drive_strength(BFO_OUTPUT, SI5351_DRIVE_2MA); // 2,4,6 or 8ma
-      delay(1);
-      si5351.output_enable(BFO_OUTPUT, 0);
-      digitalWrite(CW_KEY, LOW);
+      if (!env_busy) { // at full drive, take the first step down now
+         env_last = micros();
+         if (env_drive>SI5351_DRIVE_2MA) {
+            env_drive = (enum si5351_drive)(env_drive-1);
+            synthDrive(BFO_OUTPUT, env_drive);
+         }
+      }
+      env_up   = false;
+      env_busy = true;
+      schedAt(millis()+1);
     #else
       digitalWrite(CW_KEY, LOW);
     #endif
+    EVENT(EV_KEY, 0);
     noTone(CW_TONE);
 }
 
@@ -129,6 +201,9 @@ void CWoff() {
 // being able to buffer the entire beacon string simplifies things
 #define CW_SEND_BUFLEN (CWBEACON_MAXLEN)
 byte cw_send_buffer[CW_SEND_BUFLEN];
+#if HAVE_MEMSTATS
+const unsigned int mem_cw = sizeof(cw_send_buffer);
+#endif
 byte cw_send_head=0, cw_send_tail=0;
 byte cw_send_state=0; // 0=code bit next, 1=gap bit next
 byte cw_send_current=0; // remains of char we are currently sending.
@@ -292,13 +367,13 @@ bool send_cw_char(char ch) {
 // Supports prosigns embedded as <XX>
 // The source string is accessed via the provided getCharFunc so we can use this same
 // code for any string stored anywhere.
-typedef byte (*getCharFunc)(unsigned int addr);
+typedef byte (*getCharFunc)(uintptr_t addr);
 
-void _send_cw_string(unsigned int ptr, byte maxlen, getCharFunc getChar) {
+void _send_cw_string(uintptr_t ptr, byte maxlen, getCharFunc getChar) {
   char ch, ch2;
-  unsigned int pse;
-  unsigned int s=ptr;
-  unsigned int maxpos=s+maxlen;
+  uintptr_t pse;
+  uintptr_t s=ptr;
+  uintptr_t maxpos=s+maxlen;
   
   while ((s<maxpos) && (ch=getChar(s))) { 
     pse=0;
@@ -321,16 +396,16 @@ void _send_cw_string(unsigned int ptr, byte maxlen, getCharFunc getChar) {
 
 
 // helper funcs for _send_cw_string accessing ram and progmem. The eeprom one lives in utils.cpp.
-static byte _getByte_mem(unsigned int addr) {
+static byte _getByte_mem(uintptr_t addr) {
   return *((char *)addr);
 }
-static byte _getByte_pgm(unsigned int addr) {
+static byte _getByte_pgm(uintptr_t addr) {
   return (char)pgm_read_byte(addr);
 }
 
 void send_cw_string(char *s) {
 #if 1
-  _send_cw_string((unsigned int)s, CW_SEND_BUFLEN, &_getByte_mem);
+  _send_cw_string((uintptr_t)s, CW_SEND_BUFLEN, &_getByte_mem);
 #else
   char *pse;
   while (*s) { 
@@ -354,7 +429,7 @@ void send_cw_string(char *s) {
 
 void send_cw_string(const __FlashStringHelper *fs) {
 #if 1
-  _send_cw_string((unsigned int)fs, CW_SEND_BUFLEN, &_getByte_pgm);
+  _send_cw_string((uintptr_t)fs, CW_SEND_BUFLEN, &_getByte_pgm);
 #else
   char ch, ch2, *pse, *s=(char *)fs;
   while ((ch=pgm_read_byte(s))) { 
@@ -379,7 +454,7 @@ void send_cw_string(const __FlashStringHelper *fs) {
 
 void send_cw_string(const __EEPROMStringHelper *es, byte maxlen) {
 #if 1
-  _send_cw_string((unsigned int)es, maxlen, &getEEPROMByte);
+  _send_cw_string((uintptr_t)es, maxlen, &getEEPROMByte);
 #else
   char ch, ch2;
   unsigned int pse;
@@ -406,13 +481,30 @@ void send_cw_string(const __EEPROMStringHelper *es, byte maxlen) {
 #endif
 }
 
+#if HAVE_BENCH
+// Flushes the send buffer, so anything being sent is lost.
+void bench_cw() {
+  volatile char ch='Q';
+  BENCH("char2cw",         bench_sink=char2cw(ch));
+  BENCH("prosign2cw",      bench_sink=prosign2cw('A', ch));
+  BENCH("_send_cw_string", send_cw_string(F("CQ DE VK6MN <AR>")); send_cw_flush());
+}
+#endif // HAVE_BENCH
+
 #endif // HAVE_CW_SENDER
 
 
 void checkCW(){
   // Note: ensure <=10k impedance on signal - a 10k pullup resistor works just fine.
   // the internal pullup is NOT enough.
-  int key=analogRead(ANALOG_KEYER);
+  int key=ANALOG_READ(ANALOG_KEYER);
+
+  #if HAVE_BFO
+  cwEnvelope();
+  #endif
+#if HAVE_CW != 2
+  if (cw_waiting && txReady()) CWon();
+#endif
 
 #if HAVE_CW == 2
   // NEW CW code - 6-state input to handle both straight key and paddle. Costs 300 bytes of progmem
@@ -426,15 +518,20 @@ void checkCW(){
   static int last_key=0;
 
   static enum keystate cwstate=KS_NONE, last_cwstate=KS_NONE;
-  static unsigned long last=0;
   static unsigned int  hold=0;
-  
-  if (!interval(&last,hold)) return;
+
+  if (cw_waiting) { // the element is timed from when the carrier comes up, not from the key
+     if (!txReady()) return;
+     CWon();
+     taskIn(TASK_CW, hold ? hold : 1);
+     return;
+  }
+  if (!taskDue(TASK_CW)) return;
 
   if (abs(key-last_key)>80) {
      // large change in value, let it stabilize so we don't get a read as it swings and re-read.
      delay(2);
-     key=analogRead(ANALOG_KEYER);
+     key=ANALOG_READ(ANALOG_KEYER);
   }
   last_key=key;
   
@@ -570,6 +667,7 @@ void checkCW(){
        CWstop();
     }
   }
+  taskNext(TASK_CW, hold ? hold : 1); // follow a straight key closely
 
 #else
 
@@ -53,10 +53,34 @@
 #define HAVE_FILTERS      0
 #endif
 
+#ifndef HAVE_SLEEP
+#define HAVE_SLEEP        0
+#endif
+
+#ifndef HAVE_PCINT
+#define HAVE_PCINT        0
+#endif
+
+#ifndef HAVE_FASTBOOT
+#define HAVE_FASTBOOT     0
+#endif
+
+#ifndef HAVE_ENCODER
+#define HAVE_ENCODER      0
+#endif
+
+#ifndef HAVE_LAZYTUNE
+#define HAVE_LAZYTUNE     0
+#endif
+
 #ifndef HAVE_PULSE
 #define HAVE_PULSE        0
 #endif
 
+#ifndef HAVE_LOOPSTATS
+#define HAVE_LOOPSTATS    0
+#endif
+
 #ifndef HAVE_SWR
 #define HAVE_SWR          0
 #endif
@@ -77,6 +101,34 @@
 #define HAVE_ANALYSER     0
 #endif
 
+#ifndef HAVE_BENCH
+#define HAVE_BENCH        0
+#endif
+
+#ifndef HAVE_LATENCY
+#define HAVE_LATENCY      0
+#endif
+
+#ifndef HAVE_I2CSTATS
+#define HAVE_I2CSTATS     0
+#endif
+
+#ifndef HAVE_PROFILE
+#define HAVE_PROFILE      0
+#endif
+
+#ifndef HAVE_MEMSTATS
+#define HAVE_MEMSTATS     0
+#endif
+
+#ifndef HAVE_EVENTLOG
+#define HAVE_EVENTLOG     0
+#endif
+
+#ifndef HAVE_TRACE
+#define HAVE_TRACE        0
+#endif
+
 #ifndef TUNE_BANDS_ONLY
 #define TUNE_BANDS_ONLY   2
 #endif
@@ -121,5 +173,25 @@
 #define HAVE_CHANNELS 0
 #endif
 
+#if !HAVE_PCINT
+#undef HAVE_ENCODER
+#define HAVE_ENCODER 0
+#endif
+
+#if !HAVE_CAT
+#undef HAVE_BENCH
+#undef HAVE_LATENCY
+#undef HAVE_I2CSTATS
+#undef HAVE_PROFILE
+#undef HAVE_MEMSTATS
+#undef HAVE_EVENTLOG
+#define HAVE_BENCH 0
+#define HAVE_LATENCY 0
+#define HAVE_I2CSTATS 0
+#define HAVE_PROFILE 0
+#define HAVE_MEMSTATS 0
+#define HAVE_EVENTLOG 0
+#endif
+
 #endif
 
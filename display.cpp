@@ -13,6 +13,11 @@ LiquidCrystal lcd(8,9,10,11,12,13);
 #include "bitxultra.h"
 
 static char printBuff[17];
+static char bar_buf[20];    // BarGraph2()
+#if HAVE_MEMSTATS
+// the vertical bar graph chars are 56 bytes when they're kept in RAM (see setupLCD_BarGraph)
+const unsigned int mem_display = sizeof(printBuff) + sizeof(bar_buf) + 7*8;
+#endif
 
 // remember what the 8 special chars are set up for.
 enum special_states { SP_NONE, SP_VBG, SP_HBG } specialconfig=SP_NONE;
@@ -95,8 +100,8 @@ void setupLCD_BarGraph2() {
 // fill buffer with a bar that takes maxchars chars
 // The coloured portion will be based on val's position from vmin to vmax.
 char * BarGraph2(int val, int vmin, int vmax, byte maxchars) {
-  static char buf[20];
-  if (maxchars>(sizeof(buf)-1)) maxchars=sizeof(buf-1);
+  char *buf = bar_buf;
+  if (maxchars>(sizeof(bar_buf)-1)) maxchars=sizeof(bar_buf)-1;
   int v = (maxchars * 5) * (val - vmin) / (vmax - vmin);
   if (v>maxchars*5) v=maxchars*5;
   else if (v<0) v=0;
@@ -198,7 +203,8 @@ void miniMeter(const char c) {
  * indicator
  */
 
-void updateDisplay(){
+// Format line 1 of the display into c.
+void formatDisplay(){
 
     sprintf_P(b, PSTR("%08ld"), vfos[state.vfoActive].frequency);
     sprintf_P(c, PSTR("%c:%.2s.%.4s"), 'A'+state.vfoActive, b, b+2);
@@ -224,7 +230,10 @@ void updateDisplay(){
       strcat_P(c, PSTR(" +R"));
     else
       strcat_P(c, PSTR("   "));
-    
+}
+
+void updateDisplay(){
+    formatDisplay();
     printLine1(c);
 
     if ((mode==MODE_NORMAL) && !state.useVFO) {
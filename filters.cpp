@@ -8,7 +8,7 @@
 // Depending on how your filter relays are wired, you have the ability to pair different 
 // BPFs with one LPF - so you need less filters in total.
 // You _could_ have a no-filter BPF option (a wire link) for all-frequency RX.
-// Note - the FIRST matching band is used... so order is important!
+// Note - bands must be in frequency order and must not overlap. This is checked when compiling.
 
 // handy macro for use with latched relays. Connect the set coils to outputs 0-15, reset coils to 16-31.
 // or alter the macro to suit your layout.
@@ -43,7 +43,7 @@ Frequency findNextBandFreq(Frequency f) {
 // Set the above line to #if 1 and put your custom band and filter definitions here
 // Each band costs 12 bytes of progmem
 #define FILTER_DEFAULT 0x0000
-const struct band txbands[] PROGMEM = {
+constexpr struct band txbands[] PROGMEM = {
   //{lo:   135700l, hi:   137800l, tx:true, filter:-},
   //{lo:   472000l, hi:   479000l, tx:true, filter:-},
 //  {lo:  1800000l, hi:  1875000l, tx:true, filter:-}, // 160m
@@ -82,7 +82,7 @@ const struct band txbands[] PROGMEM = {
 //SPARES   0x2060 (3 left)
 
 #define FILTER_DEFAULT 0x0000                             // bypass BPFs & LPFs - RX only
-const struct band txbands[] PROGMEM = {
+constexpr struct band txbands[] PROGMEM = {
 //  {lo:   135700l, hi:   137800l, tx:false, filter:FILTER_DEFAULT},
 //  {lo:   472000l, hi:   479000l, tx:false, filter:FILTER_DEFAULT},
   {lo:  1800000l, hi:  1875000l, tx:true,  filter:BPFA(F1) | LPFA(F1) }, // 160m
@@ -101,6 +101,46 @@ const struct band txbands[] PROGMEM = {
 };
 #endif // 0/1
 
+#define NO_BAND    0xFF
+static_assert(sizeof(txbands)/sizeof(struct band) < NO_BAND, "Too many bands in txbands");
+constexpr byte BAND_COUNT = sizeof(txbands)/sizeof(struct band);
+
+// findBand() walks forward from the band index, so the bands must be in order.
+constexpr bool bandsSorted(byte i) {
+  return txbands[i].lo <= txbands[i].hi &&
+         (i+1 >= BAND_COUNT || (txbands[i].hi < txbands[i+1].lo && bandsSorted(i+1)));
+}
+static_assert(bandsSorted(0), "txbands must be in frequency order and the bands must not overlap");
+
+/*
+ * Coarse index into txbands, generated from it when compiling. Frequencies are split into
+ * buckets of 2^BAND_BUCKET_SHIFT Hz (about 1MHz) and each bucket has the first band that
+ * doesn't end below it, so findBand() skips every band below the bucket. Bands that share
+ * a bucket (80m and 80m DX, or 60m split into channels) are still searched one by one.
+ * The bucket count is a constant of its own so findBand() never reads txbands outside
+ * pgm_read_*().
+ */
+#define BAND_BUCKET_SHIFT 20
+constexpr unsigned BAND_BUCKETS = (txbands[BAND_COUNT-1].hi >> BAND_BUCKET_SHIFT) + 1;
+static_assert(BAND_BUCKETS <= 255, "txbands goes too high for the band index");
+
+constexpr byte bucketFirst(Frequency start, byte i) {
+  return (i >= BAND_COUNT || txbands[i].hi >= start) ? i : bucketFirst(start, i+1);
+}
+
+// BandIndex<0,1,2...BAND_BUCKETS-1>::index[] holds bucketFirst() of each bucket.
+template<byte... B> struct BandIndex {
+  static const byte index[sizeof...(B)];
+};
+template<byte... B> const byte BandIndex<B...>::index[sizeof...(B)] PROGMEM = {
+  bucketFirst((Frequency)B << BAND_BUCKET_SHIFT, 0)...
+};
+template<byte N, byte... B> struct MakeBandIndex : MakeBandIndex<N-1, N-1, B...> {};
+template<byte... B> struct MakeBandIndex<0, B...> {
+  typedef BandIndex<B...> type;
+};
+typedef MakeBandIndex<BAND_BUCKETS>::type band_index;
+
 /**
  * Raduino needs to keep track of current state of the transceiver. These are a few variables that do it
  */
@@ -139,6 +179,10 @@ static const byte pcf857x_addrs[PCF857X_COUNT] PROGMEM = PCF857X_ADDRS;
 void setFilters_PCF857X(FilterId filt) { // any combo of PCF857X-like chips at any addresses
   byte i=0;
   char s;
+  #if HAVE_I2CSTATS
+  unsigned long t=micros();
+  byte bytes=0;
+  #endif
   filt = ~filt; // invert all outputs.
   while ((i<PCF857X_COUNT) && (s=pgm_read_byte(&pcf857x_sizes[i]))) {
     Wire.beginTransmission(pgm_read_byte(&pcf857x_addrs[i]));
@@ -146,10 +190,16 @@ void setFilters_PCF857X(FilterId filt) { // any combo of PCF857X-like chips at a
       Wire.write(filt & 0xFF);
       filt>>=8;
       s-=8;
+      #if HAVE_I2CSTATS
+      bytes++;
+      #endif
     }
     Wire.endTransmission();
     i++;
   }
+  #if HAVE_I2CSTATS
+  i2cAccount(I2C_FILTER, i, bytes, t);
+  #endif
 }
 
 FilterId getFilters_PCF857X() {
@@ -187,75 +237,119 @@ void setFilters_IO(byte filt) { // Direct control via IO pins. Max 3 outputs onl
 #endif
 
 
-void setFilters(const struct band *band) {
-  unsigned int filt = band ? band->filter : FILTER_DEFAULT;
-  if (!txFilterInit || (filt != txFilter)) {
-     if (inTx!=INTX_NONE && inTx!=INTX_DIS) {
-        digitalWrite(TX_RX, 0); // Turn off RF output while switching.
-        delay(20);
-     }
+/*
+ * A filter change is a little state machine run from loop(), so nothing waits for the relays:
+ *  during TX: FILT_MUTE until the T/R sequencer has the RF output off (filtersMuted())
+ *  then the new outputs are set and the latching relays powered,
+ *  FILT_PULSE for FILTER_PULSE_MS, then the relay power is cut (filtersCheck())
+ *  and the T/R sequencer unmutes once filtersBusy() is false.
+ * In RX the switch starts straight away, and filtersBusy() tells the T/R sequencer to keep
+ * TX_RX low until it's done, so a change started by TXon() never runs with the PA live.
+ * A change asked for while one is under way is remembered in filt_next and done straight after.
+ */
+enum filtstate { FILT_IDLE, FILT_MUTE, FILT_PULSE };
+static enum filtstate filt_state=FILT_IDLE;
+static FilterId       filt_next;
 
+static void switchFilters(FilterId filt) {
      FILTER_CONTROL(filt);
+     EVENT(EV_FILTER, filt);
      txFilter=filt;
      txFilterInit=true;
-     
-     #if FILTER_I2C
-       #ifdef FILTER_PIN0
-         #ifdef FILTER_RELAYS_ON
-           digitalWrite(FILTER_PIN0, FILTER_RELAYS_ON); // power relays
-           delay(20);
-           #ifdef FILTER_RELAYS_OFF
-             digitalWrite(FILTER_PIN0, FILTER_RELAYS_OFF); // cut relay power
-           #endif
-         #endif
-       #endif
-       #ifdef FILTER_RELAYS_OFF
-         FILTER_CONTROL(FILTER_RELAYS_OFF==HIGH ? 0xFFFFFFFF : 0x00000000);
-       #endif
-     #else // Direct IO (non-I2C) control only
-       #ifdef FILTER_RELAYS_OFF
-         delay(30);
-         setFilters_IO(FILTER_RELAYS_OFF==HIGH ? 0xFF : 0x00);
-       #endif
+     filt_next=filt;
+     filt_state=FILT_IDLE;
+
+     #if FILTER_I2C && defined(FILTER_PIN0) && defined(FILTER_RELAYS_ON)
+       digitalWrite(FILTER_PIN0, FILTER_RELAYS_ON); // power relays
+     #endif
+     #ifdef FILTER_RELAYS_OFF
+       filt_state=FILT_PULSE;
+       taskIn(TASK_FILTER, FILTER_PULSE_MS);
      #endif
+}
 
-     if (inTx!=INTX_NONE && inTx!=INTX_DIS) {
-        delay(20);
-        digitalWrite(TX_RX, 1);
-     }
+static void startFilters(FilterId filt) {
+  if (txFilterInit && filt == txFilter) return;
+  #if HAVE_PTT
+  if (trMute()) { // the T/R relays are in TX, even if TX itself has just ended. Otherwise TX_RX is held low.
+     filt_next=filt;
+     filt_state=FILT_MUTE;
+     return;
   }
+  #endif
+  switchFilters(filt);
+}
+
+void setFilters(const struct band *band) {
+  FilterId filt = band ? band->filter : FILTER_DEFAULT;
+  if (filt_state!=FILT_IDLE) {
+     filt_next=filt; // busy, switch to the latest one when done.
+     return;
+  }
+  startFilters(filt);
+}
+
+// End the relay pulse, then start any change that came in meanwhile.
+void filtersCheck() {
+  if (filt_state!=FILT_PULSE) return;
+  if (!taskDue(TASK_FILTER)) return;
+
+  #ifdef FILTER_RELAYS_OFF
+    #if FILTER_I2C
+      #if defined(FILTER_PIN0) && defined(FILTER_RELAYS_ON)
+        digitalWrite(FILTER_PIN0, FILTER_RELAYS_OFF); // cut relay power
+      #endif
+      FILTER_CONTROL(FILTER_RELAYS_OFF==HIGH ? 0xFFFFFFFF : 0x00000000);
+    #else // Direct IO (non-I2C) control only
+      setFilters_IO(FILTER_RELAYS_OFF==HIGH ? 0xFF : 0x00);
+    #endif
+  #endif
+  filt_state=FILT_IDLE;
+  startFilters(filt_next);
+}
+
+// true while a filter change is waiting for the mute or the relays are switching.
+bool filtersBusy() {
+  return filt_state!=FILT_IDLE;
+}
+
+#if HAVE_PTT
+// Called by the T/R sequencer once the RF output is off.
+void filtersMuted() {
+  if (filt_state==FILT_MUTE) switchFilters(filt_next);
 }
+#endif
 
 /*
  * Return the band data for a given frequency if found.
+ * band keeps a copy of the last band found (bandidx), which is checked first.
  */
 
-static Frequency last_f=0;
-static unsigned char bandidx=0;
+static unsigned char bandidx=NO_BAND;
 
 //#define DEBUG_FIND_BAND
 
 const struct band * findBand(Frequency f) {
-  if (last_f>0) {
-     #ifndef DEBUG_FIND_BAND
-     if (f >= band.lo && f <= band.hi) return &band;
-     if (f==last_f) return NULL; // if we didn't find a band last time, don't bother looking this time.
-     #endif
-  }
+  #ifndef DEBUG_FIND_BAND
+  if (bandidx!=NO_BAND && f >= band.lo && f <= band.hi) return &band;
+  #endif
+
+  if ((f >> BAND_BUCKET_SHIFT) >= BAND_BUCKETS) return NULL;
+
+  // skip any bands that end before f in this bucket, then f is either in the next one or no band.
+  unsigned char i = pgm_read_byte(&band_index::index[f >> BAND_BUCKET_SHIFT]);
+  while (i < BAND_COUNT && f > pgm_read_dword(&(txbands[i].hi))) i++;
 
-  unsigned char i;
-  unsigned char cnt=sizeof(txbands)/sizeof(struct band);
-  for (i=0; i<cnt; i++) {
-      if ( f >= pgm_read_dword(&(txbands[i].lo)) && f <= pgm_read_dword(&(txbands[i].hi)) ) {
-         memcpy_P(&band, &txbands[i], sizeof(band));
-         #ifdef DEBUG_FIND_BAND
-           sprintf(c, "Band: %2d/%2d     ", i, cnt);
-           Serial.println(c);
-         #endif
-         last_f=f;
-         bandidx=i;
-         return &band;
-      }
+  if (i < BAND_COUNT && f >= pgm_read_dword(&(txbands[i].lo))) {
+     if (i!=bandidx) {
+        memcpy_P(&band, &txbands[i], sizeof(band));
+        bandidx=i;
+     }
+     #ifdef DEBUG_FIND_BAND
+       sprintf(c, "Band: %2d/%2d     ", i, BAND_COUNT);
+       Serial.println(c);
+     #endif
+     return &band;
   }
   return NULL;
 }
@@ -269,17 +363,17 @@ Frequency findNextBandFreq(Frequency f) {
 #elif TUNE_BANDS_ONLY == 1
 
   // find the next frequency in a defined band, based on the current band and which end we fell off
-  byte idx = bandidx;
+  byte idx = bandidx==NO_BAND ? 0 : bandidx;
   if (f<band.lo) {
      if (idx > 0) {
         idx--;
      } else {
-        idx = (sizeof(txbands)/sizeof(struct band)) -1;
+        idx = BAND_COUNT-1;
      }
      return pgm_read_dword(&(txbands[idx].hi));
      
   } else if (f>band.hi) {
-     if (idx < (sizeof(txbands)/sizeof(struct band) -1) ) {
+     if (idx < BAND_COUNT-1) {
         idx++;
      } else {
         idx=0;
@@ -47,6 +47,9 @@ struct fsq_params fsq_mode_params;
 byte fsq_buffer_pos=0; // current pos in buffer
 byte fsq_buffer_len=0; // total symbols in the buffer
 byte fsq_buffer[255];  // the buffer of symbols to TX.
+#if HAVE_MEMSTATS
+const unsigned int mem_fsq = sizeof(fsq_buffer);
+#endif
 JTEncode jtencode;
 
 char find_fsq_mode(char *m) {
@@ -146,12 +149,14 @@ unsigned long fsq_last_change=0;
 void do_fsq_tx() {
   
   if (fsq_buffer_pos<fsq_buffer_len) {
+     if (!txReady()) return; // T/R relays still settling
      if (!interval(&fsq_last_change, fsq_mode_params.tone_delay)) return;
      long delta=(fsq_mode_params.freq_ofs * SI5351_FREQ_MULT) + (fsq_buffer[fsq_buffer_pos] * fsq_mode_params.tone_spacing);
      
      #if HAVE_BFO
         //si5351.set_freq(((bfo_freq + state.bfo_trim) * SI5351_FREQ_MULT) - delta, BFO_OUTPUT);
         setBFO(bfo_freq, -delta);
+        freqCommit(); // keep the symbol timing
      #else
         Frequency f = vfos[sttate.vfoActive].frequency;
         case (vfos[state.vfoActive].mod) {
@@ -169,11 +174,13 @@ void do_fsq_tx() {
   } else if (fsq_buffer_pos>0) {
      if (!interval(&fsq_last_change, fsq_mode_params.tone_delay)) return;
      // return to RX mode
+     synthBegin();
      #if HAVE_BFO
        setBFO(bfo_freq);
      #endif
      setFrequency(RIT_AUTO);
      TXoff();
+     synthCommit();
      fsq_buffer_pos=0;
      fsq_buffer_len=0;
   }
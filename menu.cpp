@@ -61,21 +61,20 @@ void startAdjustment(const struct adjustment &adj, unsigned long val)
 }
 
 char doAdjustment() {
-  static unsigned long last=0;
-  if (!interval(&last, 400)) return ADJ_NIL;
-
   struct adjustment *adj = &adjustment_data; // using a ptr makes no diff to code size.
-  if (btnDown()) {
+  if (btnEvent()) {
      mode=MODE_NORMAL;
      strcpy_P(c, adj->desc);
      strcat_P(c, PSTR(" Set"));
      printLine2(strpad(c,16));
      if (adj->cb_set) adj->cb_set();
      holdLine2(1000); // gives the user time to read it without having to delay here
-     waitBtnUp();     // make sure the button has been released.
      return ADJ_SET;
   } else {
-      int knob = analogRead(ANALOG_TUNING);
+      if (!taskDue(TASK_ADJUST)) return ADJ_NIL;
+      taskNext(TASK_ADJUST, 400);
+
+      int knob = knobPos();
       long val = adj->value;
       if (knob < 400 && val > adj->min) {
          if (adj->step>0)      val -= adj->step;
@@ -329,8 +328,10 @@ static void h_calibrate() {
 #if HAVE_BFO
 static void s_bfotrim() {
              state.bfo_trim = adjustment_data.value;
+             synthBegin();
              setBFO(bfo_freq);
              setFrequency(RIT_AUTO);
+             synthCommit();
 }
 static void h_bfotrim() {
              defineAdjustment(A_BFO, M_BFO, BFOTRIM_MIN, BFOTRIM_MAX, BFOTRIM_STEP, NULL, &s_bfotrim, &s_bfotrim);
@@ -403,27 +404,15 @@ void setMenuItem(byte idx) {
 }
 
 void checkMenu(){
-  static unsigned long last=0;
-  static unsigned int  stepdelay=0;
-  if (!interval(&last, stepdelay)) return;
+  unsigned int stepdelay=10;
 
-  stepdelay=10;
-  if (btnDown()) {
+  if (btnEvent()) {
      
      // do menu item
      menuHandler handler= (menuHandler)pgm_read_word(&(menuItems[menuIdx].handler));
      handler();
      
-     // make sure the button is released
-#if NEW_CAL
-     waitBtnUp();
-#else
-     if (mode != MODE_CALIBRATE) {
-        waitBtnUp();
-     }
-#endif
-
-     stepdelay=200;
+     taskIn(TASK_MENU, 200); // leave the knob alone for a moment
      if ((mode==MODE_NORMAL) 
           #if HAVE_CHANNELS
           && (handler != &h_channel)
@@ -432,8 +421,10 @@ void checkMenu(){
         holdLine2(300); // gives the user time to read it without having to delay here
      }
   } else {
+    if (!taskDue(TASK_MENU)) return;
+
     // check if the tuning knob is turned, change item/value
-    int knob = analogRead(ANALOG_TUNING)-10;
+    int knob = knobPos()-10;
     if (knob < 400) {
        setMenuItem(menuIdx==0 ? MENU_LEN-1 : menuIdx-1);
        showMenuItem();
@@ -443,6 +434,7 @@ void checkMenu(){
        showMenuItem();
        stepdelay=500;
     }
+    taskNext(TASK_MENU, stepdelay);
   }
 }
 #endif // HAVE_MENU
@@ -16,6 +16,7 @@ static unsigned long last_update=0;
 static unsigned long last_recalc=0;
 
 #define HIST_COUNT 50
+#define HIST_SAMPLE 5  // ms between samples, so the history covers 250ms
 static unsigned char hist_pos=0;
 #if HAVE_SWR
 static unsigned int  rp_hist[HIST_COUNT];
@@ -25,6 +26,16 @@ static unsigned int  fp_hist[HIST_COUNT];
 static unsigned int  s_hist[HIST_COUNT];
 static unsigned int  s_hist_avg=0, s_hist_peak=0;
 #endif
+#if HAVE_MEMSTATS
+const unsigned int mem_meters = 0
+#if HAVE_SWR
+  + sizeof(rp_hist) + sizeof(fp_hist)
+#endif
+#if HAVE_SMETER
+  + sizeof(s_hist)
+#endif
+  ;
+#endif
 
 
 #if HAVE_SMETER
@@ -114,11 +125,11 @@ struct slevel_stats {
 
 static void read_meters() {
 #if HAVE_SMETER
-     s_hist[hist_pos] = analogRead(S_POWER) * S_POWER_CAL / 100;
+     s_hist[hist_pos] = ANALOG_READ(S_POWER) * S_POWER_CAL / 100;
 #endif
 #if HAVE_SWR
-     rp_hist[hist_pos] = analogRead(R_POWER) * R_POWER_CAL / 100;
-     fp_hist[hist_pos] = analogRead(F_POWER) * F_POWER_CAL / 100;
+     rp_hist[hist_pos] = ANALOG_READ(R_POWER) * R_POWER_CAL / 100;
+     fp_hist[hist_pos] = ANALOG_READ(F_POWER) * F_POWER_CAL / 100;
 #endif
      if (++hist_pos>=HIST_COUNT) hist_pos=0;
 }
@@ -188,10 +199,29 @@ static unsigned int calc_swr(unsigned int fp, unsigned int rp) {
 }
 #endif // HAVE_SWR
 
+#if HAVE_BENCH
+void bench_meters() {
+  volatile int v=S9_LEVEL/3;
+#if HAVE_SMETER
+  struct slevel_stats sp;
+  BENCH("to_slevel",         bench_sink=to_slevel(v));
+  BENCH("to_slevel S9+",     bench_sink=to_slevel(v*30));
+  BENCH("calc_slevel_stats", calc_slevel_stats(sp); bench_sink=sp.avg_s);
+#endif
+#if HAVE_SWR
+  struct power_stats pp;
+  BENCH("calc_swr",          bench_sink=calc_swr(v, v/4));
+  BENCH("calc_power_stats",  calc_power_stats(pp); bench_sink=pp.avg_fp);
+#endif
+}
+#endif // HAVE_BENCH
+
 /*
  * Display either an S-Meter (RX) or SWR meter (TX) in line2.
  */
 void doMeters() {
+  if (!taskDue(TASK_METERS)) return;
+  taskNext(TASK_METERS, HIST_SAMPLE);
   read_meters();
   
   if (!interval(&last_recalc,50)) return;
@@ -323,8 +353,9 @@ static unsigned char resultspos;
 static void toneOn() {
   #if HAVE_BFO
       setBFO(bfo_freq-50); // generate tone just inside the edge of the crystal filter passband
-      si5351.drive_strength(BFO_OUTPUT, SI5351_DRIVE_2MA); // 2,4,6 or 8ma
-      si5351.output_enable(BFO_OUTPUT, 1);
+      freqCommit();
+      synthDrive(BFO_OUTPUT, SI5351_DRIVE_2MA); // 2,4,6 or 8ma
+      synthEnable(BFO_OUTPUT, 1);
   #endif
   digitalWrite(CW_KEY, HIGH);
 }
@@ -350,7 +381,7 @@ void startAnalyser() {
         // output low powered carrier (some leaks in through the edge of the xtal filter)
         if (TXon(INTX_ANA)) { // should always be true, but....
            mode=MODE_ANALYSER;
-           toneOn();
+           // toneOn() once the T/R relays are ready
            //Serial.println(F("AN:start"));
            printLine2(F("  Analysing...  "));
         } else {
@@ -373,6 +404,8 @@ void doAnalyser() {
   if (analyser_band) {
      byte i;
      struct power_stats pwr;
+     if (!txReady()) return;
+     if (resultspos==0) toneOn();
      delay(10); // let the last frequency change stabilize
      
      for (i=0; i<HIST_COUNT; i++) {
@@ -401,12 +434,14 @@ void doAnalyser() {
      vfos[state.vfoActive].frequency += analyser_step;
      if (resultspos>=sizeof(results) || vfos[state.vfoActive].frequency >= analyser_band->hi) {
         // back to RX on previous frequency
+        synthBegin();
         toneOff();
         TXoff();
         results[resultspos++]='\0';
         analyser_band=NULL;
         vfos[state.vfoActive].frequency = prev_freq;
         setFrequency(RIT_ON);
+        synthCommit();
 
         // charset test
         //strcpy_P(results,PSTR("\xFF \x01\x02\x03\x04\x05\x06\x07\xFF      "));
@@ -419,9 +454,8 @@ void doAnalyser() {
         setFrequency(RIT_OFF);
         updateDisplay();
      }
-  } else if (btnDown()) {
+  } else if (btnEvent()) {
      // hold the display until the user presses the button.
-     waitBtnUp();
      mode=MODE_NORMAL;
      printLine2(FH(BLANKLINE));
      updateDisplay();
@@ -0,0 +1,241 @@
+
+/*
+ * Pin change interrupt capture for the PTT and function button inputs.
+ * The interrupt only timestamps the edges into a queue. pcintPoll() debounces them from loop():
+ * a change is accepted once the input has been quiet for its debounce time, and is dated
+ * from the first edge of the burst. A glitch that returns to the old level is ignored.
+ *
+ * The straight key is on an analog-only pin (A6), which has no digital input or pin change interrupt.
+ *
+ * With HAVE_ENCODER the interrupt also decodes a quadrature encoder on ENCODER_A/B as it happens,
+ * counting detents and timing them for velocity. They share the port D vector with FBUTTON.
+ * Detents are only kept for encoderRead() while something calls it on every pass.
+ */
+
+#include "bitxultra.h"
+
+#if HAVE_PCINT
+
+#define PC_QLEN 8
+
+struct pcedge {
+  unsigned long t;
+  byte          pins; // bit per pcinput, 1=pressed
+};
+static volatile struct pcedge pc_q[PC_QLEN];
+static volatile byte pc_head=0, pc_tail=0;
+static volatile byte pc_last=0;
+
+static volatile uint8_t *pc_port[PC_COUNT];
+static uint8_t pc_mask[PC_COUNT];
+#if HAVE_TRACE
+static byte pc_pin[PC_COUNT];
+#endif
+static const byte pc_debounce[PC_COUNT] PROGMEM = { PTT_DEBOUNCE, BTN_DEBOUNCE };
+
+struct pcstate {
+  unsigned long first, last; // micros of the first and last edge since the level was accepted
+  bool raw, level, changed;
+};
+static struct pcstate pc_state[PC_COUNT];
+
+#if HAVE_ENCODER
+static volatile uint8_t *enc_port_a, *enc_port_b;
+static uint8_t enc_mask_a, enc_mask_b;
+static byte enc_ab;                       // last A/B levels
+static int8_t enc_quarter=0;              // quadrature steps towards the next detent
+static volatile int enc_count=0;          // detents not yet read, + is clockwise
+static volatile bool enc_new=false;       // a detent since the start of this pass, for pcintPending()
+static bool enc_read=false;               // encoderRead() was called in the last pass
+static volatile unsigned long enc_time=0, enc_period=0; // micros of the last detent and since the one before
+
+// change in quadrature steps for [old AB][new AB], 0 for no change or a missed state
+static const int8_t enc_table[16] PROGMEM = { 0,-1, 1, 0,  1, 0, 0,-1,  -1, 0, 0, 1,  0, 1,-1, 0 };
+
+static inline byte encRead() {
+  return ((*enc_port_a & enc_mask_a) ? 2 : 0) | ((*enc_port_b & enc_mask_b) ? 1 : 0);
+}
+
+static inline void encEdge() {
+  byte ab=encRead();
+  if (ab==enc_ab) return;
+  enc_quarter += (int8_t)pgm_read_byte(&enc_table[(enc_ab<<2) | ab]);
+  enc_ab=ab;
+
+  if (enc_quarter >= ENCODER_QUARTERS || enc_quarter <= -ENCODER_QUARTERS) {
+     unsigned long t=micros();
+     enc_count += enc_quarter>0 ? 1 : -1;
+     enc_new = true;
+     enc_quarter = 0;
+     enc_period = t - enc_time;
+     enc_time   = t;
+  }
+}
+#endif
+
+static byte pcRead() {
+  byte i, pins=0;
+  for (i=0; i<PC_COUNT; i++) {
+      if (pc_mask[i] && !(*pc_port[i] & pc_mask[i])) pins |= _BV(i);
+  }
+  return pins;
+}
+
+// All the pin change vectors come here, the inputs may be on any port.
+ISR(PCINT0_vect) {
+#if HAVE_ENCODER
+  encEdge();
+#endif
+  byte pins=pcRead();
+  if (pins==pc_last) return;
+  pc_last=pins;
+
+  pc_q[pc_head].t    = micros();
+  pc_q[pc_head].pins = pins;
+  if (++pc_head>=PC_QLEN) pc_head=0;
+  if (pc_head==pc_tail) { // full, lose the oldest. Only the latest edges matter for the debounce.
+     if (++pc_tail>=PC_QLEN) pc_tail=0;
+  }
+}
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+
+static void pcintPin(byte pin) {
+  *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+  *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+}
+
+static void pcintEnable(enum pcinput in, byte pin) {
+  pc_port[in] = portInputRegister(digitalPinToPort(pin));
+  pc_mask[in] = digitalPinToBitMask(pin);
+#if HAVE_TRACE
+  pc_pin[in] = pin;
+#endif
+  pcintPin(pin);
+}
+
+// Call after the pins are set up as inputs.
+void pcintSetup() {
+  byte i;
+#if HAVE_PTT
+  pcintEnable(PC_PTT, PTT);
+#endif
+  pcintEnable(PC_BUTTON, FBUTTON);
+#if HAVE_ENCODER
+  pinMode(ENCODER_A, INPUT_PULLUP);
+  pinMode(ENCODER_B, INPUT_PULLUP);
+  enc_port_a = portInputRegister(digitalPinToPort(ENCODER_A));
+  enc_port_b = portInputRegister(digitalPinToPort(ENCODER_B));
+  enc_mask_a = digitalPinToBitMask(ENCODER_A);
+  enc_mask_b = digitalPinToBitMask(ENCODER_B);
+  enc_ab = encRead();
+  pcintPin(ENCODER_A);
+  pcintPin(ENCODER_B);
+#endif
+
+  pc_last=pcRead();
+  for (i=0; i<PC_COUNT; i++) {
+      pc_state[i].raw = pc_state[i].level = pc_last & _BV(i);
+  }
+}
+
+// Called at the start of every pass of loop().
+void pcintPoll() {
+  byte i;
+  struct pcedge e;
+  struct pcstate *s;
+  unsigned long now;
+
+  for (i=0; i<PC_COUNT; i++) pc_state[i].changed=false;
+
+#if HAVE_ENCODER
+  // Nothing is tuning with the encoder (menus, channels...), so what it turned is lost,
+  // rather than jumping the VFO when it's next read.
+  uint8_t sreg=SREG;
+  cli();
+  if (!enc_read) enc_count=0;
+  enc_new=false;
+  SREG=sreg;
+  enc_read=false;
+#endif
+
+  for (;;) {
+     uint8_t sreg=SREG;
+     cli();
+     if (pc_tail==pc_head) {
+        SREG=sreg;
+        break;
+     }
+     e.t    = pc_q[pc_tail].t;
+     e.pins = pc_q[pc_tail].pins;
+     if (++pc_tail>=PC_QLEN) pc_tail=0;
+     SREG=sreg;
+
+     for (i=0; i<PC_COUNT; i++) {
+         s = &pc_state[i];
+         bool b = e.pins & _BV(i);
+         if (b != s->raw) {
+#if HAVE_TRACE
+            if (pc_mask[i]) tracePin(e.t, pc_pin[i], !b);
+#endif
+            if (s->raw == s->level) s->first=e.t; // start of a burst
+            s->raw  = b;
+            s->last = e.t;
+         }
+     }
+  }
+
+  now=micros();
+  for (i=0; i<PC_COUNT; i++) {
+      s = &pc_state[i];
+      if (s->raw != s->level) {
+         unsigned long db = pgm_read_byte(&pc_debounce[i]) * 1000UL;
+         unsigned long quiet = now - s->last;
+         if (quiet >= db) {
+            s->level   = s->raw;
+            s->changed = true;
+         } else {
+            schedAt(millis() + (db - quiet)/1000 + 1);
+         }
+      }
+  }
+}
+
+// Anything new since the start of this pass of loop(), to wake schedWait().
+bool pcintPending() {
+#if HAVE_ENCODER
+  if (enc_new) return true;
+#endif
+  return pc_head != pc_tail;
+}
+
+bool pcintLevel(enum pcinput in) {
+  return pc_state[in].level;
+}
+
+bool pcintChanged(enum pcinput in) {
+  return pc_state[in].changed;
+}
+
+unsigned long pcintTime(enum pcinput in) {
+  return pc_state[in].first;
+}
+
+#if HAVE_ENCODER
+// Detents turned since the last call, and the micros between the last two of them.
+int encoderRead(unsigned long &period) {
+  int n;
+  unsigned long since;
+  uint8_t sreg=SREG;
+  cli();
+  n = enc_count;
+  enc_count = 0;
+  enc_read = true;
+  since = micros() - enc_time;
+  period = since > enc_period ? since : enc_period; // slowing down counts too
+  SREG=sreg;
+  return n;
+}
+#endif
+
+#endif // HAVE_PCINT
@@ -36,6 +36,13 @@ static const char CMD_CW      [] PROGMEM = "cw";
 static const char CMD_CWB     [] PROGMEM = "cwb";
 static const char CMD_FSQ     [] PROGMEM = "fsq";
 static const char CMD_FSQB    [] PROGMEM = "fsqb";
+static const char CMD_BENCH   [] PROGMEM = "bench";
+static const char CMD_LAT     [] PROGMEM = "lat";
+static const char CMD_I2C     [] PROGMEM = "i2c";
+static const char CMD_PROF    [] PROGMEM = "prof";
+static const char CMD_MEM     [] PROGMEM = "mem";
+static const char CMD_EV      [] PROGMEM = "ev";
+static const char CMD_SLEEP   [] PROGMEM = "sleep";
 static const char CMD_HELP    [] PROGMEM = "help";
 
 typedef PGM_P (*remoteHandler)(char *p);
@@ -49,7 +56,13 @@ struct cmd {
 
 #define SERIAL_IN_SIZE 30
 static char serial_in[SERIAL_IN_SIZE+1];
+#if HAVE_MEMSTATS
+const unsigned int mem_serial = sizeof(serial_in);
+#endif
 static unsigned char serial_in_count = 0;
+#if HAVE_TRACE
+static unsigned long serial_in_time; // micros of the first char of the line
+#endif
 
 
 static PGM_P h_status(char *p) {
@@ -342,8 +355,10 @@ static PGM_P h_bfotrim(char *p) {
      if (trim<BFOTRIM_MIN || trim>BFOTRIM_MAX)
         return ERR_RANGE;
      state.bfo_trim = trim;
+     synthBegin();
      setBFO(bfo_freq);
      setFrequency(RIT_AUTO);
+     synthCommit();
   } else {
      Serial.print(F("BFOTRIM:"));
      Serial.println(state.bfo_trim);
@@ -354,6 +369,7 @@ static PGM_P h_bfotrim(char *p) {
 
 #endif // !CAT_MINIMAL
 
+#if HAVE_PTT
 static PGM_P h_tx(char *p) {
      if (!strcmp_P(p,PSTR("on"))) {
         if (TXon(INTX_CAT)) {
@@ -365,12 +381,13 @@ static PGM_P h_tx(char *p) {
      }
      return NULL;
 }
+#endif
 
 #if HAVE_SMETER
 static PGM_P h_meter(char *p) {
   UNUSED(p)
      if (inTx!=INTX_NONE) {
-        sprintf_P(c,PSTR("SWR:%1.1f"),last_swr/100);
+        sprintf_P(c,PSTR("SWR:%u.%u"),last_swr/100,(last_swr/10)%10); // no float printf on the AVR
         Serial.println(c);
      } else {
         #define StoNum(s) (s<=9 ? s : (s-9) * 10)
@@ -392,6 +409,72 @@ static PGM_P h_ann(char *p) {
 }
 #endif
 
+#if HAVE_BENCH
+static PGM_P h_bench(char *p) {
+  UNUSED(p)
+  if (inTx!=INTX_NONE)
+     return ERR_INTX;
+  runBenchmarks();
+  return NULL;
+}
+#endif
+
+#if HAVE_LATENCY
+static PGM_P h_lat(char *p) {
+  UNUSED(p)
+  latReport();
+  return NULL;
+}
+#endif
+
+#if HAVE_I2CSTATS
+static PGM_P h_i2c(char *p) {
+  UNUSED(p)
+  i2cReport();
+  return NULL;
+}
+#endif
+
+#if HAVE_PROFILE
+static PGM_P h_prof(char *p) {
+  UNUSED(p)
+  profReport();
+  return NULL;
+}
+#endif
+
+#if HAVE_MEMSTATS
+static PGM_P h_mem(char *p) {
+  UNUSED(p)
+  memReport();
+  return NULL;
+}
+#endif
+
+#if HAVE_EVENTLOG
+static PGM_P h_ev(char *p) {
+  UNUSED(p)
+  evDump();
+  return NULL;
+}
+#endif
+
+#if HAVE_SLEEP
+// time (ms) spent asleep and awake since last asked, and % asleep.
+static PGM_P h_sleep(char *p) {
+  UNUSED(p)
+  unsigned long asleep, awake;
+  sleepStats(asleep, awake);
+  Serial.print(F("SLEEP:"));
+  Serial.print(asleep);
+  Serial.print(FH(S_COMMA));
+  Serial.print(awake);
+  Serial.print(FH(S_COMMA));
+  Serial.println(asleep+awake ? asleep*100/(asleep+awake) : 0);
+  return NULL;
+}
+#endif
+
 #if !CAT_MINIMAL
 static PGM_P h_help(char *p);
 #endif
@@ -440,6 +523,27 @@ static const struct cmd commandlist[] PROGMEM = {
 #if HAVE_ANALYSER
   { CMD_ANN,      &h_ann },
 #endif
+#if HAVE_BENCH
+  { CMD_BENCH,    &h_bench },
+#endif
+#if HAVE_LATENCY
+  { CMD_LAT,      &h_lat },
+#endif
+#if HAVE_I2CSTATS
+  { CMD_I2C,      &h_i2c },
+#endif
+#if HAVE_PROFILE
+  { CMD_PROF,     &h_prof },
+#endif
+#if HAVE_MEMSTATS
+  { CMD_MEM,      &h_mem },
+#endif
+#if HAVE_EVENTLOG
+  { CMD_EV,       &h_ev },
+#endif
+#if HAVE_SLEEP
+  { CMD_SLEEP,    &h_sleep },
+#endif
 #if !CAT_MINIMAL
   { CMD_HELP,     &h_help },
 #endif
@@ -484,12 +588,21 @@ void process_command(char *cmd)
               Serial.println(FH(err));
            } else {
               Serial.println(F("OK"));
+              #if HAVE_LATENCY
+              if (handler==&h_freq) latEnd(LAT_CAT);
+              #endif
            }
+           #if HAVE_LATENCY
+           latCancel(LAT_CAT);
+           #endif
            return;
         }
         i++;
   }
   Serial.println(F("ERR:Unknown Command"));
+  #if HAVE_LATENCY
+  latCancel(LAT_CAT);
+  #endif
 }
 
 /**
@@ -506,6 +619,9 @@ void serialEvent()
          case '\r':
          case '\n': if (serial_in_count>0) {
                        serial_in[serial_in_count]='\0';
+                       #if HAVE_TRACE
+                       traceRx(serial_in_time, serial_in);
+                       #endif
 #if 0
                        Serial.print(F(">"));
                        Serial.println(serial_in);
@@ -514,7 +630,14 @@ void serialEvent()
                        serial_in_count=0;
                     }
                     break;
-         default:   if (serial_in_count < (SERIAL_IN_SIZE-1)) serial_in[serial_in_count++]=ch;
+         default:
+                    #if HAVE_LATENCY
+                    if (serial_in_count==0) latStart(LAT_CAT, micros()); // first char of a new line
+                    #endif
+                    #if HAVE_TRACE
+                    if (serial_in_count==0) serial_in_time=micros();
+                    #endif
+                    if (serial_in_count < (SERIAL_IN_SIZE-1)) serial_in[serial_in_count++]=ch;
      }
   }
 }
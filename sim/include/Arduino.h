@@ -0,0 +1,169 @@
+/*
+ * Arduino core for the host simulation build (see sim/Makefile).
+ * Only what the firmware uses. The pins, registers and clock are simulated in sim.cpp.
+ *
+ * The host is not an AVR: int is 32 bits and long is 64 bits, so overflows of 16 bit ints
+ * don't show up here. Timing and I/O behaviour is what this build is for.
+ */
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool    boolean;
+typedef unsigned int word;
+
+#define HIGH 1
+#define LOW  0
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+#define DEFAULT  1
+#define EXTERNAL 0
+#define INTERNAL 3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define NUM_DIGITAL_PINS 22
+#define LED_BUILTIN 13
+
+#define F_CPU 16000000UL
+#define RAMSTART 0x100
+#define RAMEND   0x8FF
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define abs(x) ((x)>0?(x):-(x))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define bit(b) (1UL << (b))
+#define bitRead(value, b) (((value) >> (b)) & 0x01)
+#define bitSet(value, b) ((value) |= (1UL << (b)))
+#define bitClear(value, b) ((value) &= ~(1UL << (b)))
+#define _BV(b) (1 << (b))
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+// ATmega328 registers the firmware touches directly.
+extern volatile uint8_t SREG, MCUSR, PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2, PINB, PINC, PIND;
+extern volatile uint16_t SP;
+#define WDRF  3
+#define BORF  2
+#define EXTRF 1
+#define PORF  0
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+
+#define cli() (SREG &= 0x7F)
+#define sei() (SREG |= 0x80)
+#define noInterrupts() cli()
+#define interrupts() sei()
+
+// Nano pin mapping: D0-7 port D, D8-13 port B, A0-5 port C. A6/A7 are analog only.
+#define NOT_A_PORT 0
+#define PB 2
+#define PC 3
+#define PD 4
+#define digitalPinToPort(p)     ((p) <= 7 ? PD : (p) <= 13 ? PB : (p) <= 19 ? PC : NOT_A_PORT)
+#define digitalPinToBitMask(p)  _BV((p) <= 7 ? (p) : (p) <= 13 ? (p) - 8 : (p) - 14)
+#define portInputRegister(P)    ((P) == PB ? &PINB : (P) == PC ? &PINC : &PIND)
+#define digitalPinToPCICR(p)    (&PCICR)
+#define digitalPinToPCICRbit(p) ((p) <= 7 ? 2 : (p) <= 13 ? 0 : 1)
+#define digitalPinToPCMSK(p)    ((p) <= 7 ? &PCMSK2 : (p) <= 13 ? &PCMSK0 : &PCMSK1)
+#define digitalPinToPCMSKbit(p) ((p) <= 7 ? (p) : (p) <= 13 ? (p) - 8 : (p) - 14)
+
+// Interrupt handlers are plain functions, called by the simulation when an enabled pin changes.
+#define ISR(vector, ...) extern "C" void vector(void) __VA_ARGS__; extern "C" void vector(void)
+#define ISR_ALIASOF(target) __attribute__((alias(#target)))
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
+
+class Print {
+  public:
+    virtual size_t write(uint8_t c) = 0;
+    size_t write(const char *s) { size_t n=0; while (*s) n += write((uint8_t)*s++); return n; }
+    size_t write(const uint8_t *buf, size_t len) { size_t n=0; while (len--) n += write(*buf++); return n; }
+
+    size_t print(const __FlashStringHelper *s) { return write((const char *)s); }
+    size_t print(const char s[]) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return printNumber(n, base); }
+    size_t print(int n, int base = DEC) { return printSigned(n, base); }
+    size_t print(unsigned int n, int base = DEC) { return printNumber(n, base); }
+    size_t print(long n, int base = DEC) { return printSigned(n, base); }
+    size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+    size_t print(double n, int digits = 2) { char s[32]; snprintf(s, sizeof(s), "%.*f", digits, n); return write(s); }
+
+    size_t println() { return write("\r\n"); }
+    template<class T> size_t println(T v) { size_t n = print(v); return n + println(); }
+    template<class T> size_t println(T v, int base) { size_t n = print(v, base); return n + println(); }
+
+  private:
+    size_t printSigned(long n, int base) {
+      if (base == DEC && n < 0) return write('-') + printNumber(-(unsigned long)n, base);
+      return printNumber((unsigned long)n, base);
+    }
+    size_t printNumber(unsigned long n, int base) {
+      char buf[8 * sizeof(long) + 1], *s = &buf[sizeof(buf) - 1];
+      *s = '\0';
+      if (base < 2) base = 10;
+      do {
+        char c = n % base;
+        n /= base;
+        *--s = c < 10 ? c + '0' : c + 'A' - 10;
+      } while (n);
+      return write(s);
+    }
+};
+
+class HardwareSerial : public Print {
+  public:
+    void begin(unsigned long baud);
+    int  available();
+    int  availableForWrite();
+    int  read();
+    int  peek();
+    void flush();
+    virtual size_t write(uint8_t c);
+    using Print::write;
+    operator bool() { return true; }
+};
+extern HardwareSerial Serial;
+
+void setup();
+void loop();
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include <Arduino.h>
+
+// 1k of EEPROM, erased (0xFF) at start. Each byte written takes the 3.3ms the AVR does.
+class EEPROMClass {
+  public:
+    uint8_t read(int address);
+    void    write(int address, uint8_t value);
+    void    update(int address, uint8_t value) { if (read(address) != value) write(address, value); }
+    uint16_t length() { return 1024; }
+    template<class T> T &get(int address, T &t) {
+      uint8_t *p = (uint8_t *)&t;
+      for (size_t i = 0; i < sizeof(T); i++) p[i] = read(address + i);
+      return t;
+    }
+    template<class T> const T &put(int address, const T &t) {
+      const uint8_t *p = (const uint8_t *)&t;
+      for (size_t i = 0; i < sizeof(T); i++) update(address + i, p[i]);
+      return t;
+    }
+};
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SIM_JTENCODE_H
+#define SIM_JTENCODE_H
+
+#include <Arduino.h>
+
+// The symbol counts are the library's. The encoders send tone 0 for every symbol,
+// which is enough for timing the beacon.
+#define JT9_SYMBOL_COUNT  85
+#define JT65_SYMBOL_COUNT 126
+#define JT4_SYMBOL_COUNT  206
+#define WSPR_SYMBOL_COUNT 162
+
+class JTEncode {
+  public:
+    void jt9_encode(const char *, uint8_t *symbols)  { memset(symbols, 0, JT9_SYMBOL_COUNT); }
+    void jt65_encode(const char *, uint8_t *symbols) { memset(symbols, 0, JT65_SYMBOL_COUNT); }
+    void jt4_encode(const char *, uint8_t *symbols)  { memset(symbols, 0, JT4_SYMBOL_COUNT); }
+    void wspr_encode(const char *, const char *, uint8_t, uint8_t *symbols) { memset(symbols, 0, WSPR_SYMBOL_COUNT); }
+    void fsq_encode(const char *, const char *, uint8_t *symbols) { symbols[0] = 0xFF; }
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SIM_LIQUIDCRYSTAL_H
+#define SIM_LIQUIDCRYSTAL_H
+
+#include <Arduino.h>
+
+// HD44780 in 4 bit mode. Keeps what is on the screen, and each command or character takes
+// the time the Arduino library spends sending it.
+class LiquidCrystal : public Print {
+  public:
+    LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+    void begin(uint8_t cols, uint8_t rows);
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void createChar(uint8_t location, uint8_t charmap[]);
+    void noCursor() {}
+    void cursor() {}
+    virtual size_t write(uint8_t c);
+    using Print::write;
+};
+
+#endif
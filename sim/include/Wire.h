@@ -0,0 +1,22 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+// I2C bus. Each transaction takes the simulated bus time. Writes to a device are latched
+// and read back by requestFrom(), which is how a PCF857X port expander behaves.
+class TwoWire {
+  public:
+    void    begin();
+    void    setClock(uint32_t hz);
+    void    beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool stop = true);
+    size_t  write(uint8_t data);
+    size_t  write(const uint8_t *data, size_t len);
+    uint8_t requestFrom(uint8_t address, uint8_t len);
+    int     available();
+    int     read();
+};
+extern TwoWire Wire;
+
+#endif
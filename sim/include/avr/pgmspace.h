@@ -0,0 +1,64 @@
+/*
+ * Program memory is ordinary memory on the host.
+ * pgm_read_word() and pgm_read_ptr() return the type pointed at, so the tables of
+ * string pointers read back whole pointers rather than the 16 bits they are on the AVR.
+ */
+#ifndef SIM_PGMSPACE_H
+#define SIM_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+template<class T> inline T sim_pgm_read(const T *p) { return *p; }
+
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  sim_pgm_read(addr)
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)   sim_pgm_read(addr)
+
+#define memcpy_P   memcpy
+#define strcpy_P   strcpy
+#define strncpy_P  strncpy
+#define strcat_P   strcat
+#define strcmp_P   strcmp
+#define strncmp_P  strncmp
+#define strcasecmp_P strcasecmp
+#define strlen_P   strlen
+#define strchr_P   strchr
+#define sprintf_P  sim_sprintf_P
+#define snprintf_P snprintf
+
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t n = strlen(src);
+  if (size) {
+     size_t m = n < size - 1 ? n : size - 1;
+     memcpy(dst, src, m);
+     dst[m] = '\0';
+  }
+  return n;
+}
+#define strlcpy_P strlcpy
+
+// avr-libc's %S is a string in program memory, the host's is a wide string.
+inline int sim_sprintf_P(char *buf, const char *fmt, ...) {
+  char f[128];
+  size_t i;
+  va_list ap;
+  for (i=0; fmt[i] && i < sizeof(f) - 1; i++) {
+      f[i] = fmt[i];
+      if (i && fmt[i] == 'S' && fmt[i-1] == '%') f[i] = 's';
+  }
+  f[i] = '\0';
+  va_start(ap, fmt);
+  int n = vsprintf(buf, f, ap);
+  va_end(ap);
+  return n;
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef SIM_SLEEP_H
+#define SIM_SLEEP_H
+
+// sleep_cpu() moves the simulated clock on to the next interrupt: a millis() tick or an input change.
+#define SLEEP_MODE_IDLE 0
+void set_sleep_mode(uint8_t mode);
+void sleep_enable();
+void sleep_disable();
+void sleep_cpu();
+
+#endif
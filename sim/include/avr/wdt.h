@@ -0,0 +1,10 @@
+#ifndef SIM_WDT_H
+#define SIM_WDT_H
+
+#define WDTO_15MS 0
+#define WDTO_1S   6
+void wdt_disable();
+void wdt_enable(uint8_t timeout);
+void wdt_reset();
+
+#endif
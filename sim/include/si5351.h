@@ -0,0 +1,43 @@
+#ifndef SIM_SI5351_H
+#define SIM_SI5351_H
+
+#include <Arduino.h>
+
+/*
+ * Si5351 with the interface of the Etherkit library. The registers are kept, so the output
+ * frequencies can be worked out from what the firmware wrote. set_freq() fills in the multisynth
+ * the way the library does, with the PLL fixed at SI5351_PLL_FIXED and no R divider.
+ */
+#define SI5351_FREQ_MULT     100ULL
+#define SI5351_PLL_FIXED     80000000000ULL
+#define SI5351_XTAL_FREQ     25000000UL
+
+#define SI5351_CRYSTAL_LOAD_6PF  (1<<6)
+#define SI5351_CRYSTAL_LOAD_8PF  (2<<6)
+#define SI5351_CRYSTAL_LOAD_10PF (3<<6)
+
+#define SI5351_OUTPUT_ENABLE_CTRL 3
+#define SI5351_CLK0_CTRL          16
+#define SI5351_CLK0_PARAMETERS    42
+#define SI5351_PLL_RESET          177
+
+enum si5351_clock { SI5351_CLK0, SI5351_CLK1, SI5351_CLK2, SI5351_CLK3, SI5351_CLK4, SI5351_CLK5, SI5351_CLK6, SI5351_CLK7 };
+enum si5351_pll { SI5351_PLLA, SI5351_PLLB };
+enum si5351_drive { SI5351_DRIVE_2MA, SI5351_DRIVE_4MA, SI5351_DRIVE_6MA, SI5351_DRIVE_8MA };
+enum si5351_pll_input { SI5351_PLL_INPUT_XO, SI5351_PLL_INPUT_CLKIN };
+
+class Si5351 {
+  public:
+    bool    init(uint8_t xtal_load_c, uint32_t xo_freq, int32_t corr);
+    uint8_t set_freq(uint64_t freq, enum si5351_clock clk);
+    void    set_pll(uint64_t pll_freq, enum si5351_pll target_pll);
+    void    set_correction(int32_t corr, enum si5351_pll_input ref_osc);
+    void    output_enable(enum si5351_clock clk, uint8_t enable);
+    void    drive_strength(enum si5351_clock clk, enum si5351_drive drive);
+    uint8_t si5351_write_bulk(uint8_t addr, uint8_t bytes, uint8_t *data);
+    uint8_t si5351_write(uint8_t addr, uint8_t data);
+    uint8_t si5351_read(uint8_t addr);
+    uint64_t plla_freq, pllb_freq;
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef SIM_ATOMIC_H
+#define SIM_ATOMIC_H
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_BLOCK(type) for (uint8_t sim_sreg = SREG, sim_once = (cli(), 1); sim_once; SREG = sim_sreg, sim_once = 0)
+
+#endif
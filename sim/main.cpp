@@ -0,0 +1,148 @@
+/*
+ * bitxsim: runs the firmware's setup() and loop() on the simulated Raduino and reports how
+ * often loop() runs and how long each pass takes, in simulated time.
+ *
+ *  bitxsim [-t seconds] [-k knob] [-r trace] [-v] [-q]
+ *   -t  simulated time to run loop() for after setup(), or after the last input of a trace, default 10 or 1
+ *   -k  tuning pot reading, 0-1023, default 512
+ *   -r  replay the inputs in a trace (see trace.cpp) and report the latencies measured
+ *   -v  show the serial output, screen changes and Si5351 frequency changes as they happen
+ *   -q  one line: passes/s, avg, p99 and max pass time (us), % asleep
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <Arduino.h>
+#include "sim.h"
+
+static bool verbose=false;
+
+extern void serialEvent() __attribute__((weak));
+
+// trace.cpp
+extern uint64_t traceLoad(const char *file);
+extern void traceOutput(enum simout kind, int a, int b, const char *s);
+extern void traceReport();
+
+static void stamp() {
+  printf("[%4u.%06u] ", (unsigned)(sim_now / 1000000), (unsigned)(sim_now % 1000000));
+}
+
+void simOutput(enum simout kind, int a, int b, const char *s) {
+  traceOutput(kind, a, b, s);
+  if (!verbose) return;
+  switch (kind) {
+    case SIM_OUT_PIN:
+         stamp();
+         printf("pin %d %s\n", a, b ? "HIGH" : "LOW");
+         break;
+    case SIM_OUT_LINE:
+         stamp();
+         printf("serial: %s\n", s);
+         break;
+    default:
+         break;
+  }
+}
+
+// In verbose mode, show what changed on the screen and the Si5351 outputs since the last pass.
+static void showChanges() {
+  static std::string lcd[2];
+  static double freq[3];
+  int i;
+  for (i=0; i<2; i++) {
+      if (lcd[i] != simLcdLine(i)) {
+         lcd[i] = simLcdLine(i);
+         stamp();
+         printf("lcd%d: [%s]\n", i+1, lcd[i].c_str());
+      }
+  }
+  for (i=0; i<3; i++) {
+      double f = simSynthFreq(i);
+      if (f != freq[i]) {
+         freq[i] = f;
+         stamp();
+         printf("clk%d: %.2f Hz\n", i, f);
+      }
+  }
+}
+
+static uint32_t percentile(const std::vector<uint32_t> &v, unsigned pc) {
+  return v.empty() ? 0 : v[(v.size() - 1) * pc / 100];
+}
+
+static double share(uint64_t us, uint64_t total) {
+  return total ? 100.0 * us / total : 0;
+}
+
+int main(int argc, char **argv) {
+  double seconds=0;
+  int knob=512;
+  const char *trace=NULL;
+  uint64_t trace_end=0;
+  bool quiet=false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:k:r:vq")) != -1) {
+    switch (opt) {
+      case 't': seconds = atof(optarg); break;
+      case 'k': knob = atoi(optarg); break;
+      case 'r': trace = optarg; break;
+      case 'v': verbose = true; break;
+      case 'q': quiet = true; break;
+      default:
+           fprintf(stderr, "usage: %s [-t seconds] [-k knob] [-r trace] [-v] [-q]\n", argv[0]);
+           return 2;
+    }
+  }
+
+  simReset();
+  simInput(0, SIM_ADC, A7, knob);
+  if (trace && !(trace_end = traceLoad(trace))) {
+     fprintf(stderr, "%s: can't read %s\n", argv[0], trace);
+     return 1;
+  }
+  if (!seconds) seconds = trace ? 1 : 10;
+
+  setup();
+  if (verbose) showChanges();
+  uint64_t setup_us = sim_now;
+  struct simusage start = sim_usage;
+
+  std::vector<uint32_t> passes;
+  uint64_t end = (trace_end > sim_now ? trace_end : sim_now) + (uint64_t)(seconds * 1e6);
+  while (sim_now < end) {
+     uint64_t t = sim_now;
+     loop();
+     if (serialEvent && Serial.available()) serialEvent(); // as the Arduino core does between passes
+     passes.push_back(sim_now - t);
+     if (verbose) showChanges();
+  }
+
+  uint64_t total = sim_now - setup_us;
+  uint64_t sum = 0;
+  for (uint32_t p : passes) sum += p;
+  std::sort(passes.begin(), passes.end());
+  double rate = passes.size() / (total / 1e6);
+  uint32_t avg = passes.empty() ? 0 : sum / passes.size();
+
+  if (quiet) {
+     printf("%.1f %u %u %u %.1f\n", rate, avg, percentile(passes, 99), passes.empty() ? 0 : passes.back(),
+            share(sim_usage.sleep - start.sleep, total));
+     return 0;
+  }
+
+  printf("setup(): %.3f ms\n", setup_us / 1000.0);
+  printf("loop(): %zu passes in %.3f s, %.1f/s\n", passes.size(), total / 1e6, rate);
+  printf("pass us: min %u avg %u p50 %u p99 %u max %u\n", passes.empty() ? 0 : passes.front(), avg,
+         percentile(passes, 50), percentile(passes, 99), passes.empty() ? 0 : passes.back());
+  printf("time in: sleep %.1f%% delay %.1f%% adc %.1f%% i2c %.1f%% lcd %.1f%% eeprom %.1f%% serial wait %.1f%%\n",
+         share(sim_usage.sleep - start.sleep, total), share(sim_usage.delay - start.delay, total),
+         share(sim_usage.adc - start.adc, total), share(sim_usage.i2c - start.i2c, total),
+         share(sim_usage.lcd - start.lcd, total), share(sim_usage.eeprom - start.eeprom, total),
+         share(sim_usage.serial_stall - start.serial_stall, total));
+  if (trace) traceReport();
+  return 0;
+}
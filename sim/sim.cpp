@@ -0,0 +1,553 @@
+/*
+ * The simulated Nano: clock, pins, interrupts, ADC and serial port, and the devices on the
+ * Raduino: Si5351, LCD, EEPROM and anything else on the I2C bus.
+ */
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <Wire.h>
+#include <EEPROM.h>
+#include <LiquidCrystal.h>
+#include <si5351.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include "sim.h"
+
+uint64_t sim_now;
+struct simusage sim_usage;
+
+/*
+ * Inputs, kept in time order.
+ */
+struct siminput {
+  uint64_t t;
+  enum simin kind;
+  uint8_t pin;
+  int value;
+};
+static std::vector<siminput> sim_inputs;
+static size_t sim_next;
+
+void simInput(uint64_t t, enum simin kind, uint8_t pin, int value) {
+  siminput in = { t, kind, pin, value };
+  auto at = std::upper_bound(sim_inputs.begin() + sim_next, sim_inputs.end(), in,
+                             [](const siminput &a, const siminput &b) { return a.t < b.t; });
+  sim_inputs.insert(at, in);
+}
+
+uint64_t simNextInput() {
+  return sim_next < sim_inputs.size() ? sim_inputs[sim_next].t : ~0ULL;
+}
+
+/*
+ * Registers and interrupts. A pin change on an enabled pin sets its PCIFR flag, and the
+ * handler runs as soon as interrupts are on. Handlers don't nest.
+ */
+volatile uint8_t SREG=0x80, MCUSR, PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2, PINB, PINC, PIND;
+volatile uint16_t SP=RAMEND;
+
+extern "C" {
+void PCINT0_vect(void) __attribute__((weak));
+void PCINT1_vect(void) __attribute__((weak));
+void PCINT2_vect(void) __attribute__((weak));
+void PCINT0_vect(void) {}
+void PCINT1_vect(void) {}
+void PCINT2_vect(void) {}
+}
+static void (* const sim_vectors[3])(void) = { PCINT0_vect, PCINT1_vect, PCINT2_vect };
+static bool sim_in_isr=false;
+
+static void simInterrupts() {
+  byte i, due;
+  while (!sim_in_isr && (SREG & 0x80) && (due = PCIFR & PCICR)) {
+     for (i=0; i<3; i++) {
+         if (!(due & _BV(i))) continue;
+         PCIFR &= ~_BV(i);
+         sim_in_isr = true;
+         SREG &= 0x7F;
+         sim_vectors[i]();
+         SREG |= 0x80;
+         sim_in_isr = false;
+     }
+  }
+}
+
+/*
+ * Pins. level is what a digitalRead() sees: the output if it is one, otherwise what drives
+ * the input from outside, or the pull-up.
+ */
+static uint8_t pin_mode[NUM_DIGITAL_PINS];
+static int8_t  pin_drive[NUM_DIGITAL_PINS];   // level from outside, -1 if nothing
+static uint8_t pin_out[NUM_DIGITAL_PINS];
+static int     adc[8];
+
+static uint8_t pinLevel(uint8_t pin) {
+  if (pin_mode[pin] == OUTPUT) return pin_out[pin];
+  if (pin_drive[pin] >= 0) return pin_drive[pin];
+  return pin_mode[pin] == INPUT_PULLUP;
+}
+
+// Refresh the PINx register of a pin, and flag its pin change interrupt if it changed.
+static void pinUpdate(uint8_t pin) {
+  if (pin > 19) return; // A6 and A7 are analog only
+  volatile uint8_t *reg = portInputRegister(digitalPinToPort(pin));
+  uint8_t mask = digitalPinToBitMask(pin);
+  uint8_t old = *reg;
+  if (pinLevel(pin)) *reg |= mask;
+  else               *reg &= ~mask;
+  if (old != *reg && (*digitalPinToPCMSK(pin) & _BV(digitalPinToPCMSKbit(pin)))) {
+     PCIFR |= _BV(digitalPinToPCICRbit(pin));
+  }
+}
+
+/*
+ * Serial port. Bytes in wait in the 64 byte receive buffer. Bytes out go at the baud rate
+ * through the 64 byte transmit buffer, and a write waits when it is full.
+ */
+#define SERIAL_BUFFER 64
+static std::string ser_rx;
+static std::string ser_line;
+static uint32_t ser_byte_us = 1042;  // 10 bits at 9600 baud
+static uint64_t ser_tx_done;         // when the last byte queued will have gone
+
+static void applyInput(const siminput &in) {
+  switch (in.kind) {
+    case SIM_PIN:
+         pin_drive[in.pin] = in.value;
+         pinUpdate(in.pin);
+         break;
+    case SIM_ADC:
+         adc[in.pin >= A0 ? in.pin - A0 : in.pin] = in.value;
+         break;
+    case SIM_RX:
+         if (ser_rx.size() < SERIAL_BUFFER) ser_rx += (char)in.value;
+         break;
+  }
+}
+
+void simTime(uint32_t us) {
+  uint64_t until = sim_now + us;
+  while (!sim_in_isr && simNextInput() <= until) {
+     const siminput &in = sim_inputs[sim_next++];
+     if (in.t > sim_now) sim_now = in.t;
+     applyInput(in);
+     simInterrupts();
+  }
+  if (sim_now < until) sim_now = until;
+  simInterrupts();
+}
+
+/*
+ * Arduino core
+ */
+unsigned long millis() {
+  simTime(SIM_MILLIS_US);
+  return sim_now / 1000;
+}
+
+unsigned long micros() {
+  simTime(SIM_MICROS_US);
+  return (uint32_t)sim_now;
+}
+
+void delay(unsigned long ms) {
+  sim_usage.delay += ms * 1000;
+  simTime(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  sim_usage.delay += us;
+  simTime(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  simTime(SIM_DIGITAL_US);
+  if (pin >= NUM_DIGITAL_PINS) return;
+  pin_mode[pin] = mode;
+  pinUpdate(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  simTime(SIM_DIGITAL_US);
+  if (pin >= NUM_DIGITAL_PINS) return;
+  val = val ? HIGH : LOW;
+  if (pin_mode[pin] != OUTPUT) { // turns the pull-up on or off
+     pin_mode[pin] = val ? INPUT_PULLUP : INPUT;
+  } else if (pin_out[pin] != val) {
+     pin_out[pin] = val;
+     simOutput(SIM_OUT_PIN, pin, val, NULL);
+  }
+  pinUpdate(pin);
+}
+
+int digitalRead(uint8_t pin) {
+  simTime(SIM_DIGITAL_US);
+  if (pin >= NUM_DIGITAL_PINS || pin > 19) return LOW;
+  return pinLevel(pin);
+}
+
+int analogRead(uint8_t pin) {
+  sim_usage.adc += SIM_ANALOG_US;
+  simTime(SIM_ANALOG_US);
+  return adc[(pin >= A0 ? pin - A0 : pin) & 7];
+}
+
+void analogReference(uint8_t) {}
+
+void tone(uint8_t, unsigned int, unsigned long) {
+  simTime(SIM_TONE_US);
+}
+
+void noTone(uint8_t) {
+  simTime(SIM_TONE_US);
+}
+
+// Sleep until the next millis() tick, or sooner if an input raises an interrupt.
+void set_sleep_mode(uint8_t) {}
+void sleep_enable() {}
+void sleep_disable() {}
+
+void sleep_cpu() {
+  uint64_t wake = (sim_now / SIM_TICK_US + 1) * SIM_TICK_US;
+  size_t i;
+  for (i = sim_next; i < sim_inputs.size() && sim_inputs[i].t < wake; i++) {
+      const siminput &in = sim_inputs[i];
+      if (in.kind == SIM_RX || (in.kind == SIM_PIN && in.pin <= 19 &&
+          (*digitalPinToPCMSK(in.pin) & _BV(digitalPinToPCMSKbit(in.pin))))) {
+         wake = in.t > sim_now ? in.t : sim_now;
+         break;
+      }
+  }
+  sim_usage.sleep += wake - sim_now;
+  simTime(wake - sim_now);
+}
+
+void wdt_disable() {}
+void wdt_enable(uint8_t) {}
+void wdt_reset() {}
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud) {
+  ser_byte_us = 10000000UL / baud;
+}
+
+int HardwareSerial::available() {
+  simTime(SIM_SERIAL_US);
+  return ser_rx.size();
+}
+
+int HardwareSerial::availableForWrite() {
+  simTime(SIM_SERIAL_US);
+  uint64_t queued = ser_tx_done > sim_now ? (ser_tx_done - sim_now + ser_byte_us - 1) / ser_byte_us : 0;
+  return queued < SERIAL_BUFFER ? SERIAL_BUFFER - queued : 0;
+}
+
+int HardwareSerial::peek() {
+  simTime(SIM_SERIAL_US);
+  return ser_rx.empty() ? -1 : (byte)ser_rx[0];
+}
+
+int HardwareSerial::read() {
+  simTime(SIM_SERIAL_US);
+  if (ser_rx.empty()) return -1;
+  int c = (byte)ser_rx[0];
+  ser_rx.erase(0, 1);
+  return c;
+}
+
+void HardwareSerial::flush() {
+  if (ser_tx_done > sim_now) {
+     sim_usage.serial_stall += ser_tx_done - sim_now;
+     simTime(ser_tx_done - sim_now);
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  simTime(SIM_SERIAL_US);
+  uint64_t full = (uint64_t)SERIAL_BUFFER * ser_byte_us;
+  if (ser_tx_done > sim_now + full) { // wait for room in the buffer
+     uint64_t wait = ser_tx_done - sim_now - full;
+     sim_usage.serial_stall += wait;
+     simTime(wait);
+  }
+  ser_tx_done = (ser_tx_done > sim_now ? ser_tx_done : sim_now) + ser_byte_us;
+
+  if (c == '\n') {
+     simOutput(SIM_OUT_LINE, 0, 0, ser_line.c_str());
+     ser_line.clear();
+  } else if (c != '\r') {
+     ser_line += (char)c;
+  }
+  return 1;
+}
+
+/*
+ * I2C bus
+ */
+TwoWire Wire;
+static uint8_t wire_addr;
+static std::vector<uint8_t> wire_tx;
+static std::map<uint8_t, std::vector<uint8_t> > wire_latch;
+static std::vector<uint8_t> wire_rx;
+
+static void i2cTime(unsigned bytes, unsigned txns) {
+  uint32_t us = bytes * SIM_I2C_BYTE_US + txns * SIM_I2C_TXN_US;
+  sim_usage.i2c += us;
+  simTime(us);
+}
+
+void TwoWire::begin() {}
+void TwoWire::setClock(uint32_t) {}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  wire_addr = address;
+  wire_tx.clear();
+}
+
+size_t TwoWire::write(uint8_t data) {
+  wire_tx.push_back(data);
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len) {
+  wire_tx.insert(wire_tx.end(), data, data + len);
+  return len;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+  i2cTime(wire_tx.size() + 1, 2);
+  wire_latch[wire_addr] = wire_tx;
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t len) {
+  i2cTime(len + 1, 2);
+  std::vector<uint8_t> &latch = wire_latch[address];
+  wire_rx.assign(len, 0xFF);
+  for (size_t i = 0; i < len && i < latch.size(); i++) wire_rx[i] = latch[i];
+  return len;
+}
+
+int TwoWire::available() {
+  return wire_rx.size();
+}
+
+int TwoWire::read() {
+  if (wire_rx.empty()) return -1;
+  int c = wire_rx.front();
+  wire_rx.erase(wire_rx.begin());
+  return c;
+}
+
+/*
+ * EEPROM
+ */
+EEPROMClass EEPROM;
+static uint8_t eeprom[1024];
+
+uint8_t EEPROMClass::read(int address) {
+  sim_usage.eeprom += SIM_EEPROM_READ_US;
+  simTime(SIM_EEPROM_READ_US);
+  return eeprom[address & 1023];
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  sim_usage.eeprom += SIM_EEPROM_WRITE_US;
+  simTime(SIM_EEPROM_WRITE_US);
+  eeprom[address & 1023] = value;
+}
+
+/*
+ * LCD, 16x2. The custom characters 0-7 show as '0'-'7'.
+ */
+static char lcd_text[2][17];
+static uint8_t lcd_col, lcd_row;
+
+static void lcdTime(uint32_t us) {
+  sim_usage.lcd += us;
+  simTime(us);
+}
+
+LiquidCrystal::LiquidCrystal(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t) {}
+
+void LiquidCrystal::begin(uint8_t, uint8_t) {
+  lcdTime(50000 + 4500 * 2 + 150 + 6 * SIM_LCD_SEND_US); // the library's power up sequence
+  clear();
+}
+
+void LiquidCrystal::clear() {
+  lcdTime(SIM_LCD_SEND_US + SIM_LCD_CLEAR_US);
+  memset(lcd_text, ' ', sizeof(lcd_text));
+  lcd_text[0][16] = lcd_text[1][16] = '\0';
+  lcd_col = lcd_row = 0;
+}
+
+void LiquidCrystal::home() {
+  lcdTime(SIM_LCD_SEND_US + SIM_LCD_CLEAR_US);
+  lcd_col = lcd_row = 0;
+}
+
+void LiquidCrystal::setCursor(uint8_t col, uint8_t row) {
+  lcdTime(SIM_LCD_SEND_US);
+  lcd_col = col;
+  lcd_row = row & 1;
+}
+
+void LiquidCrystal::createChar(uint8_t, uint8_t[]) {
+  lcdTime(9 * SIM_LCD_SEND_US);
+}
+
+size_t LiquidCrystal::write(uint8_t c) {
+  lcdTime(SIM_LCD_SEND_US);
+  if (lcd_col < 16) lcd_text[lcd_row][lcd_col] = c < 8 ? '0' + c : c;
+  lcd_col++;
+  return 1;
+}
+
+const char *simLcdLine(uint8_t row) {
+  return lcd_text[row & 1];
+}
+
+/*
+ * Si5351. Register writes go over the bus and are kept, set_freq() and set_pll() go through
+ * the same path with the transactions the library uses.
+ */
+#define SI_ADDR 0x60
+static uint8_t si_regs[256];
+static bool    si_first[8];
+
+static void siWrite(uint8_t reg, uint8_t n, const uint8_t *data) {
+  i2cTime(n + 2, 2);
+  memcpy(&si_regs[reg], data, n);
+  simOutput(SIM_OUT_SYNTH, reg, n, NULL);
+}
+
+static uint8_t siRead(uint8_t reg) {
+  i2cTime(4, 3);
+  return si_regs[reg];
+}
+
+static void siParams(uint8_t reg, uint32_t p1, uint32_t p2, uint32_t p3, uint8_t keep2) {
+  uint8_t p[8];
+  p[0] = p3 >> 8;
+  p[1] = p3;
+  p[2] = (keep2 & 0xFC) | ((p1 >> 16) & 0x03);
+  p[3] = p1 >> 8;
+  p[4] = p1;
+  p[5] = ((p3 >> 12) & 0xF0) | ((p2 >> 16) & 0x0F);
+  p[6] = p2 >> 8;
+  p[7] = p2;
+  siWrite(reg, 8, p);
+}
+
+bool Si5351::init(uint8_t xtal_load_c, uint32_t, int32_t) {
+  uint8_t v = 0xFF;
+  siWrite(SI5351_OUTPUT_ENABLE_CTRL, 1, &v);
+  for (int i = 0; i < 8; i++) {
+      v = 0x80; // powered down
+      siWrite(SI5351_CLK0_CTRL + i, 1, &v);
+      si_first[i] = true;
+  }
+  v = xtal_load_c | 0x12;
+  siWrite(183, 1, &v);
+  plla_freq = pllb_freq = SI5351_PLL_FIXED;
+  return true;
+}
+
+void Si5351::set_pll(uint64_t pll_freq, enum si5351_pll target_pll) {
+  // a + b/c = pll / xtal, with c = 2^20-1 as the library does
+  uint64_t xtal = (uint64_t)SI5351_XTAL_FREQ * SI5351_FREQ_MULT;
+  uint32_t a = pll_freq / xtal;
+  uint32_t c = 0xFFFFF;
+  uint32_t b = (uint64_t)(pll_freq % xtal) * c / xtal;
+  uint32_t p1 = 128 * a + (128 * b / c) - 512;
+  uint32_t p2 = 128 * b - c * (128 * b / c);
+  siParams(target_pll == SI5351_PLLA ? 26 : 34, p1, p2, c, 0);
+  if (target_pll == SI5351_PLLA) plla_freq = pll_freq;
+  else                           pllb_freq = pll_freq;
+}
+
+void Si5351::set_correction(int32_t, enum si5351_pll_input) {}
+
+uint8_t Si5351::set_freq(uint64_t freq, enum si5351_clock clk) {
+  if (!freq) return 1;
+  if (si_first[clk]) {
+     output_enable(clk, 1);
+     si_first[clk] = false;
+  }
+  // divider = pll / freq = a + b/c
+  uint64_t pll = SI5351_PLL_FIXED;
+  uint32_t a = pll / freq;
+  uint32_t c = 0xFFFFF;
+  uint32_t b = (uint64_t)(pll % freq) * c / freq;
+  uint32_t p1 = 128 * a + (128 * b / c) - 512;
+  uint32_t p2 = 128 * b - c * (128 * b / c);
+  uint8_t reg = SI5351_CLK0_PARAMETERS + 8 * clk;
+  uint8_t r2 = siRead(reg + 2);
+  siParams(reg, p1, p2, c, r2 & 0x80);  // no R divider, no divide by 4
+
+  uint8_t ctrl = siRead(SI5351_CLK0_CTRL + clk);
+  ctrl = (ctrl & ~0xC0) | 0x0C;          // powered up, fractional, multisynth source
+  siWrite(SI5351_CLK0_CTRL + clk, 1, &ctrl);
+  return 0;
+}
+
+void Si5351::output_enable(enum si5351_clock clk, uint8_t enable) {
+  uint8_t oe = siRead(SI5351_OUTPUT_ENABLE_CTRL);
+  if (enable) oe &= ~_BV(clk);
+  else        oe |=  _BV(clk);
+  siWrite(SI5351_OUTPUT_ENABLE_CTRL, 1, &oe);
+}
+
+void Si5351::drive_strength(enum si5351_clock clk, enum si5351_drive drive) {
+  uint8_t ctrl = siRead(SI5351_CLK0_CTRL + clk);
+  ctrl = (ctrl & ~0x03) | drive;
+  siWrite(SI5351_CLK0_CTRL + clk, 1, &ctrl);
+}
+
+uint8_t Si5351::si5351_write_bulk(uint8_t addr, uint8_t bytes, uint8_t *data) {
+  siWrite(addr, bytes, data);
+  return 0;
+}
+
+uint8_t Si5351::si5351_write(uint8_t addr, uint8_t data) {
+  siWrite(addr, 1, &data);
+  return 0;
+}
+
+uint8_t Si5351::si5351_read(uint8_t addr) {
+  return siRead(addr);
+}
+
+double simSynthFreq(uint8_t clk) {
+  const uint8_t *ms = &si_regs[SI5351_CLK0_PARAMETERS + 8 * clk];
+  uint8_t ctrl = si_regs[SI5351_CLK0_CTRL + clk];
+  if ((si_regs[SI5351_OUTPUT_ENABLE_CTRL] & _BV(clk)) || (ctrl & 0x80)) return 0;
+
+  uint32_t p3 = ((uint32_t)(ms[5] & 0xF0) << 12) | (ms[0] << 8) | ms[1];
+  uint32_t p1 = ((uint32_t)(ms[2] & 0x03) << 16) | (ms[3] << 8) | ms[4];
+  uint32_t p2 = ((uint32_t)(ms[5] & 0x0F) << 16) | (ms[6] << 8) | ms[7];
+  if (!p3) return 0;
+  double div = (p1 + 512 + (double)p2 / p3) / 128.0;
+  double pll = (double)SI5351_PLL_FIXED / SI5351_FREQ_MULT;
+  return pll / div / (1 << ((ms[2] >> 4) & 0x07));
+}
+
+/*
+ * Power on: pins are inputs without pull-ups, nothing is driving them. The tuning pot is in the
+ * middle, the keyer input (with its pull-up) and everything else analog at 0.
+ */
+void simReset() {
+  memset(pin_mode, INPUT, sizeof(pin_mode));
+  memset(pin_drive, -1, sizeof(pin_drive));
+  memset(pin_out, 0, sizeof(pin_out));
+  memset(adc, 0, sizeof(adc));
+  adc[7] = 512;
+  adc[6] = 1023;
+  memset(eeprom, 0xFF, sizeof(eeprom));
+  memset(si_regs, 0, sizeof(si_regs));
+}
@@ -0,0 +1,59 @@
+/*
+ * Host simulation of the Raduino: a virtual clock, the Nano's pins and the devices on them.
+ *
+ * Nothing here uses the host's clock, so a run is the same every time for the same inputs.
+ * The firmware's own code takes no simulated time. Time passes in delay(), in sleep and in the
+ * I/O calls, each of which costs what it takes on a 16MHz Nano (the SIM_*_US figures below).
+ * That is where the time goes on the real thing: ADC conversions, the I2C bus at 100kHz,
+ * the LCD, EEPROM writes and the serial port at its baud rate.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+// Cost of each call in us, from the Arduino core and libraries on a 16MHz ATmega328.
+#define SIM_MICROS_US      4
+#define SIM_MILLIS_US      2
+#define SIM_DIGITAL_US     4     // digitalRead(), digitalWrite(), pinMode()
+#define SIM_ANALOG_US      112   // 13 ADC clocks at 125kHz, plus the call
+#define SIM_TONE_US        20
+#define SIM_SERIAL_US      3     // available(), read(), queueing a byte to send
+#define SIM_I2C_BYTE_US    90    // 9 bits at 100kHz
+#define SIM_I2C_TXN_US     20    // start, restart or stop
+#define SIM_LCD_SEND_US    265   // one character or command, 4 bit mode
+#define SIM_LCD_CLEAR_US   2000  // extra for clear() and home()
+#define SIM_EEPROM_READ_US 1
+#define SIM_EEPROM_WRITE_US 3400 // erase and write one byte
+#define SIM_TICK_US        1024  // timer0 overflow, the millis() interrupt that wakes a sleep
+
+extern uint64_t sim_now;         // virtual time in us since reset
+
+// Spend us of simulated time, delivering any input changes that fall due.
+void simTime(uint32_t us);
+
+// Input changes, at a time in us. Applied when the clock gets there.
+enum simin { SIM_PIN, SIM_ADC, SIM_RX };
+void simInput(uint64_t t, enum simin kind, uint8_t pin, int value);
+uint64_t simNextInput();         // time of the next input change, ~0 if none
+
+// What the firmware did, for the reports. Called by the simulated devices.
+enum simout {
+  SIM_OUT_PIN,      // a = pin, b = level
+  SIM_OUT_SYNTH,    // a = first register written, b = count
+  SIM_OUT_LINE,     // a serial line was sent, text in s
+};
+void simOutput(enum simout kind, int a, int b, const char *s);
+
+// Time spent in each kind of work, us.
+struct simusage {
+  uint64_t sleep, delay, adc, i2c, lcd, eeprom, serial_stall;
+};
+extern struct simusage sim_usage;
+
+// The Si5351 output frequency of clk in Hz, 0 if off.
+double simSynthFreq(uint8_t clk);
+const char *simLcdLine(uint8_t row);
+void simReset();
+
+#endif
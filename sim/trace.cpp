@@ -0,0 +1,109 @@
+/*
+ * Trace replay. Reads the TR: lines the firmware sends with HAVE_TRACE (other lines are
+ * ignored, so a whole saved serial log will do) and queues them as simulated inputs at their
+ * times. Traces can also be written by hand, one input per line, # for comments:
+ *
+ *   TR:time,adc,pin,value    analog input, 0-1023
+ *   TR:time,pin,pin,level    digital input, 0 or 1
+ *   TR:time,rx,text          a line received on the serial port
+ *
+ * Times are in us since reset, pins are Arduino pin numbers (A7 is 21). The TR: is optional.
+ *
+ * While the trace runs, the latency of each knob movement, PTT press and CAT "freq" command
+ * is measured from outside the firmware: from the input change to the first Si5351 write to
+ * the VFO (clk2), to TX_RX going high and to the "OK" reply. Changes with no response within
+ * half a second, like a knob movement inside the hysteresis, are counted but not measured.
+ */
+
+#include <algorithm>
+#include <vector>
+#include <Arduino.h>
+#include "sim.h"
+#include "build/config.h"
+
+#define SERIAL_BYTE_US 1042 // 10 bits at the firmware's 9600 baud
+#define SI_MS2_FIRST   58   // clk2 multisynth registers
+#define SI_MS2_LAST    65
+#define LAT_TIMEOUT_US 500000 // an input change with no response by then had none
+
+struct latency {
+  const char *name;
+  std::vector<uint64_t> starts;  // input changes, in time order
+  size_t next;                   // first start not yet answered
+  std::vector<uint32_t> us;
+};
+static struct latency lat_knob = { "knob", {}, 0, {} }, lat_ptt = { "ptt", {}, 0, {} }, lat_cat = { "cat", {}, 0, {} };
+
+// The first output after an input change ends the measurement for every change before it.
+static void latEnd(struct latency &l) {
+  while (l.next < l.starts.size() && l.starts[l.next] + LAT_TIMEOUT_US < sim_now) l.next++;
+  if (l.next >= l.starts.size() || l.starts[l.next] > sim_now) return;
+  l.us.push_back(sim_now - l.starts[l.next]);
+  while (l.next < l.starts.size() && l.starts[l.next] <= sim_now) l.next++;
+}
+
+// Queue the trace in file as inputs. Returns the time of the last one, or 0 if it can't be read.
+uint64_t traceLoad(const char *file) {
+  FILE *f = fopen(file, "r");
+  char line[256], kind[8], *p;
+  unsigned long long t, last=0;
+  int pin, value, n, ptt=HIGH, knob=-1;
+
+  if (!f) return 0;
+  while (fgets(line, sizeof(line), f)) {
+     line[strcspn(line, "\r\n")] = '\0';
+     p = strncmp(line, "TR:", 3) ? line : line + 3;
+     if (sscanf(p, "%llu,%7[a-z],%n", &t, kind, &n) != 2) continue;
+     p += n;
+     if (!strcmp(kind, "rx")) {
+        if (!strncmp(p, "freq ", 5)) lat_cat.starts.push_back(t);
+        for (; *p; p++, t += SERIAL_BYTE_US) simInput(t, SIM_RX, 0, *p);
+        simInput(t, SIM_RX, 0, '\n');
+     } else if (sscanf(p, "%d,%d", &pin, &value) == 2) {
+        if (!strcmp(kind, "adc")) {
+           if (pin == ANALOG_TUNING && value != knob && knob >= 0) lat_knob.starts.push_back(t);
+           if (pin == ANALOG_TUNING) knob = value;
+           simInput(t, SIM_ADC, pin, value);
+        } else if (!strcmp(kind, "pin")) {
+           if (pin == PTT && value == LOW && ptt == HIGH) lat_ptt.starts.push_back(t);
+           if (pin == PTT) ptt = value;
+           simInput(t, SIM_PIN, pin, value);
+        } else {
+           continue;
+        }
+     } else {
+        continue;
+     }
+     if (t > last) last = t;
+  }
+  fclose(f);
+  for (struct latency *l : { &lat_knob, &lat_ptt, &lat_cat }) std::sort(l->starts.begin(), l->starts.end());
+  return last ? last : 1;
+}
+
+void traceOutput(enum simout kind, int a, int b, const char *s) {
+  switch (kind) {
+    case SIM_OUT_SYNTH:
+         if (a <= SI_MS2_LAST && a + b > SI_MS2_FIRST) latEnd(lat_knob);
+         break;
+    case SIM_OUT_PIN:
+         if (a == TX_RX && b == HIGH) latEnd(lat_ptt);
+         break;
+    case SIM_OUT_LINE:
+         if (!strcmp(s, "OK")) latEnd(lat_cat);
+         break;
+  }
+}
+
+void traceReport() {
+  for (struct latency *l : { &lat_knob, &lat_ptt, &lat_cat }) {
+      std::vector<uint32_t> &v = l->us;
+      uint64_t sum = 0;
+      for (uint32_t us : v) sum += us;
+      std::sort(v.begin(), v.end());
+      printf("latency %-4s: %zu of %zu", l->name, v.size(), l->starts.size());
+      if (!v.empty())
+         printf(", us min %u avg %u max %u", v.front(), (unsigned)(sum / v.size()), v.back());
+      printf("\n");
+  }
+}
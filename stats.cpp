@@ -0,0 +1,499 @@
+
+/*
+ * BitXUltra run-time statistics.
+ * Timing and other measurements of the firmware itself, for finding out where the time goes.
+ */
+
+#include "bitxultra.h"
+
+#if HAVE_LOOPSTATS
+/*
+ * Time each pass of loop(). Called at the start of every loop(), so the time measured
+ * includes serialEvent() and the delay at the end of loop().
+ * Once a second we dump the number of passes and the min/avg/max time of a pass (in us) to Serial.
+ */
+static unsigned long ls_start=0, ls_prev=0, ls_total=0;
+static unsigned long ls_min=0xFFFFFFFF, ls_max=0;
+static unsigned int  ls_count=0;
+
+void loopStats() {
+  unsigned long now=micros();
+
+  if (ls_count>0) {
+     unsigned long t = now - ls_prev;
+     if (t<ls_min) ls_min=t;
+     if (t>ls_max) ls_max=t;
+     ls_total += t;
+  } else {
+     ls_start = now;
+  }
+  ls_prev = now;
+  ls_count++;
+
+  if ((now - ls_start) >= 1000000UL) {
+     Serial.print(F("*Loops/s:"));
+     Serial.print(ls_count-1);
+     Serial.print(F(" us min/avg/max:"));
+     Serial.print(ls_min);
+     Serial.print(FH(S_COMMA));
+     Serial.print(ls_total/(ls_count-1));
+     Serial.print(FH(S_COMMA));
+     Serial.println(ls_max);
+
+     // start the next second from this pass.
+     ls_start=now;
+     ls_total=0;
+     ls_min=0xFFFFFFFF;
+     ls_max=0;
+     ls_count=1;
+  }
+}
+#endif // HAVE_LOOPSTATS
+
+#if HAVE_BENCH
+/*
+ * Benchmarks for the routines that get called often. Run from the CAT "bench" command.
+ * The time of an empty BENCH() loop is measured first and taken off every other result.
+ * micros() has 4us resolution, so BENCH_RUNS is set high enough that this doesn't matter much.
+ * They only mean anything on the radio: the sim's clock doesn't count CPU time, so there every
+ * result is 0, and timing the host CPU instead would say nothing about the ATmega328.
+ */
+volatile long bench_sink;
+static unsigned long bench_overhead=0;
+
+void benchReport(PGM_P name, unsigned long us) {
+  unsigned long ns = (us > bench_overhead ? us - bench_overhead : 0) * (1000 / BENCH_RUNS);
+  Serial.print(FH(name));
+  Serial.print(FH(S_COLON));
+  Serial.print(ns);
+  Serial.print(F("ns "));
+  Serial.print(ns * (F_CPU / 1000000UL) / 1000);
+  Serial.println(F("cyc"));
+}
+
+void runBenchmarks() {
+  volatile Frequency f1=7100000l, f2=14200000l;
+  volatile int v=123;
+
+  bench_overhead=0;
+  unsigned long t=micros();
+  for (byte i=0; i<BENCH_RUNS; i++) { bench_sink=v; }
+  bench_overhead=micros()-t;
+
+  BENCH("pow10",        bench_sink=pow10(v & 0x07));
+  BENCH("findBand",     bench_sink=(long)findBand(f1));
+  BENCH_I("findBand uncached", i, bench_sink=(long)findBand(i & 1 ? f1 : f2)); // alternate bands to defeat the cache
+  BENCH("findNextBand", bench_sink=findNextBandFreq(f1));
+  BENCH("BarGraph2",    bench_sink=(long)BarGraph2(v, 0, 170, 16));
+  BENCH("formatDisplay",formatDisplay());
+#if HAVE_SWR || HAVE_SMETER
+  bench_meters();
+#endif
+#if HAVE_CW_SENDER
+  bench_cw();
+#endif
+}
+#endif // HAVE_BENCH
+
+#if HAVE_LATENCY
+/*
+ * Latency probes. latStart() is given the time (micros) the input was last seen idle, latEnd() is
+ * called where the result of the input takes effect. Only one measurement per probe is in progress
+ * at a time and latEnd() is ignored if the probe wasn't started.
+ */
+static const char S_LAT_TUNE[] PROGMEM = "tune";
+static const char S_LAT_PTT [] PROGMEM = "ptt";
+static const char S_LAT_CAT [] PROGMEM = "cat";
+static PGM_P const lat_names[LAT_COUNT] PROGMEM = { S_LAT_TUNE, S_LAT_PTT, S_LAT_CAT };
+
+struct latency {
+  unsigned long start;
+  unsigned long min, max, total;
+  unsigned int  count;
+  bool          pending;
+};
+static struct latency lat[LAT_COUNT];
+
+void latStart(enum latprobe probe, unsigned long start) {
+  if (!lat[probe].pending) {
+     lat[probe].start   = start;
+     lat[probe].pending = true;
+  }
+}
+
+void latEnd(enum latprobe probe) {
+  struct latency *l = &lat[probe];
+  if (l->pending) {
+     unsigned long t = micros() - l->start;
+     if (l->count==0 || t<l->min) l->min=t;
+     if (t>l->max) l->max=t;
+     l->total += t;
+     l->count++;
+     l->pending = false;
+  }
+}
+
+void latCancel(enum latprobe probe) {
+  lat[probe].pending = false;
+}
+
+// Dump to Serial as LAT:name:count,min,avg,max and start again.
+void latReport() {
+  byte i;
+  for (i=0; i<LAT_COUNT; i++) {
+      struct latency *l = &lat[i];
+      Serial.print(F("LAT:"));
+      Serial.print(FH(pgm_read_word(&lat_names[i])));
+      Serial.print(FH(S_COLON));
+      Serial.print(l->count);
+      Serial.print(FH(S_COMMA));
+      Serial.print(l->min);
+      Serial.print(FH(S_COMMA));
+      Serial.print(l->count ? l->total/l->count : 0);
+      Serial.print(FH(S_COMMA));
+      Serial.println(l->max);
+  }
+  memset(lat, 0, sizeof(lat));
+}
+#endif // HAVE_LATENCY
+
+#if HAVE_I2CSTATS
+/*
+ * I2C bus accounting. Callers wrap their bus accesses in I2C_ACCOUNT() and say how many
+ * transactions and data bytes it takes. The time is measured.
+ * The Si5351 shadow counts its own writes with i2cCount(), by the registers each burst covers.
+ */
+static const char S_I2C_VFO   [] PROGMEM = "vfo";
+static const char S_I2C_BFO   [] PROGMEM = "bfo";
+static const char S_I2C_KEY   [] PROGMEM = "key";
+static const char S_I2C_FILTER[] PROGMEM = "filter";
+static PGM_P const i2c_names[I2C_COUNT] PROGMEM = { S_I2C_VFO, S_I2C_BFO, S_I2C_KEY, S_I2C_FILTER };
+
+struct i2cstats {
+  unsigned long txns, bytes, us;
+};
+static struct i2cstats i2c_stats[I2C_COUNT];
+
+void i2cCount(enum i2cuser who, byte txns, byte bytes, unsigned long us) {
+  struct i2cstats *s = &i2c_stats[who];
+  s->us    += us;
+  s->txns  += txns;
+  s->bytes += bytes;
+}
+
+void i2cAccount(enum i2cuser who, byte txns, byte bytes, unsigned long start) {
+  i2cCount(who, txns, bytes, micros() - start);
+}
+
+// Dump to Serial as I2C:name:transactions,bytes,us and start again.
+void i2cReport() {
+  byte i;
+  for (i=0; i<I2C_COUNT; i++) {
+      struct i2cstats *s = &i2c_stats[i];
+      Serial.print(F("I2C:"));
+      Serial.print(FH(pgm_read_word(&i2c_names[i])));
+      Serial.print(FH(S_COLON));
+      Serial.print(s->txns);
+      Serial.print(FH(S_COMMA));
+      Serial.print(s->bytes);
+      Serial.print(FH(S_COMMA));
+      Serial.println(s->us);
+  }
+  memset(i2c_stats, 0, sizeof(i2c_stats));
+}
+#endif // HAVE_I2CSTATS
+
+#if HAVE_PROFILE || HAVE_MEMSTATS
+/*
+ * loop() profiler. loop() is divided into stages by calls to PROF_MARK(stage), which charges the
+ * time and stack used since the last mark to that stage. A stage that doesn't run in a pass isn't counted.
+ * The mark at the top of loop() catches serialEvent(), which the Arduino core runs between passes.
+ */
+static const char S_PROF_CW    [] PROGMEM = "checkCW";
+static const char S_PROF_TX    [] PROGMEM = "checkTX";
+static const char S_PROF_LINE2 [] PROGMEM = "checkLine2Hold";
+static const char S_PROF_BLEEP [] PROGMEM = "bleep_check";
+static const char S_PROF_METERS[] PROGMEM = "doMeters";
+static const char S_PROF_TUNING[] PROGMEM = "doTuning";
+static const char S_PROF_BUTTON[] PROGMEM = "checkButton";
+static const char S_PROF_MENU  [] PROGMEM = "checkMenu";
+static const char S_PROF_OTHER [] PROGMEM = "other"; // HAVE_PULSE, beacons, analyser, calibration
+static const char S_PROF_DELAY [] PROGMEM = "delay";
+static const char S_PROF_SERIAL[] PROGMEM = "serialEvent";
+static PGM_P const prof_names[PROF_COUNT] PROGMEM = {
+  S_PROF_CW, S_PROF_TX, S_PROF_LINE2, S_PROF_BLEEP, S_PROF_METERS, S_PROF_TUNING, S_PROF_BUTTON,
+  S_PROF_MENU, S_PROF_OTHER, S_PROF_DELAY, S_PROF_SERIAL
+};
+
+#if HAVE_MEMSTATS
+/*
+ * Scanning and marking the free stack takes a while, so it's only done around one stage in
+ * each pass of loop(): the mark before it starts afresh and the mark after it reads how deep
+ * it went. The next pass takes the next stage, so each stage is seen every few passes.
+ * The time it takes isn't charged to any stage in the profile.
+ */
+static uint16_t stack_low[PROF_COUNT]; // lowest address the stack reached in each stage, 0 if not seen yet
+static byte     stack_mark=0;          // marks so far in this pass of loop()
+static byte     stack_probe=1;         // the mark ending the stage measured in this pass
+#endif
+
+#if HAVE_PROFILE
+#define PROF_BUCKETS 5
+static const unsigned int prof_limits[PROF_BUCKETS-1] PROGMEM = { 100, 1000, 5000, 20000 };
+
+struct profile {
+  unsigned long min, max, total;
+  unsigned int  count;
+  unsigned int  hist[PROF_BUCKETS];
+};
+static struct profile prof[PROF_COUNT];
+static unsigned long prof_last=0;
+#endif
+
+void profMark(enum profstage stage) {
+#if HAVE_PROFILE
+  unsigned long now=micros();
+  if (prof_last) {
+     struct profile *p = &prof[stage];
+     unsigned long t = now - prof_last;
+     byte i=0;
+     if (p->count==0 || t<p->min) p->min=t;
+     if (t>p->max) p->max=t;
+     if (p->count<0xFFFF) { // once count is full the avg is of the passes it counted
+        p->total += t;
+        p->count++;
+     }
+     while (i<PROF_BUCKETS-1 && t>=pgm_read_word(&prof_limits[i])) i++;
+     if (p->hist[i]<0xFFFF) p->hist[i]++;
+  }
+  prof_last=now;
+#endif
+#if HAVE_MEMSTATS
+  byte mark=stack_mark++;
+  if (mark==stack_probe) {
+     uint16_t low = getStackLow();
+     if (stack_low[stage]==0 || low<stack_low[stage]) stack_low[stage]=low;
+  } else if (mark+1==stack_probe) {
+     getStackLow(); // start afresh for the next stage
+  }
+  if (stage==PROF_DELAY) { // the last mark of the pass
+     stack_probe = stack_probe+1 < stack_mark ? stack_probe+1 : 0;
+     stack_mark=0;
+     if (stack_probe==0) getStackLow(); // the first stage starts with this mark
+  }
+  #if HAVE_PROFILE
+  prof_last=micros(); // the next stage starts after the stack work
+  #endif
+#endif
+}
+
+#if HAVE_PROFILE
+
+// Dump to Serial as PROF:name:count,min,avg,max,hist/hist/... and start again.
+void profReport() {
+  byte i, j;
+  for (i=0; i<PROF_COUNT; i++) {
+      struct profile *p = &prof[i];
+      Serial.print(F("PROF:"));
+      Serial.print(FH(pgm_read_word(&prof_names[i])));
+      Serial.print(FH(S_COLON));
+      Serial.print(p->count);
+      Serial.print(FH(S_COMMA));
+      Serial.print(p->min);
+      Serial.print(FH(S_COMMA));
+      Serial.print(p->count ? p->total/p->count : 0);
+      Serial.print(FH(S_COMMA));
+      Serial.print(p->max);
+      for (j=0; j<PROF_BUCKETS; j++) {
+          Serial.print(j ? '/' : ',');
+          Serial.print(p->hist[j]);
+      }
+      Serial.println();
+  }
+  memset(prof, 0, sizeof(prof));
+  prof_last=0;
+}
+#endif // HAVE_PROFILE
+#endif // HAVE_PROFILE || HAVE_MEMSTATS
+
+#if HAVE_MEMSTATS
+/*
+ * RAM report for the CAT "mem" command.
+ * MEM:name:bytes for the static RAM of each subsystem. "static" is all of .data and .bss,
+ * including the Arduino core and libraries, and "free" is the space between the heap and the stack now.
+ * STACK:stage:depth,free for the deepest the stack has been in each stage of loop() since boot.
+ */
+static void memLine(const __FlashStringHelper *name, unsigned int bytes) {
+  Serial.print(F("MEM:"));
+  Serial.print(name);
+  Serial.print(FH(S_COLON));
+  Serial.println(bytes);
+}
+
+extern char *__bss_end;
+
+void memReport() {
+  byte i;
+  uint16_t heap_end = getHeapEnd();
+
+  memLine(F("static"),  (uint16_t)&__bss_end - RAMSTART);
+  memLine(F("main"),    mem_main);
+  memLine(F("display"), mem_display);
+  memLine(F("bleep"),   mem_bleep);
+  memLine(F("serial"),  mem_serial);
+#if HAVE_SWR || HAVE_SMETER
+  memLine(F("meters"),  mem_meters);
+#endif
+#if HAVE_CW_SENDER
+  memLine(F("cw"),      mem_cw);
+#endif
+#if HAVE_FSQ_BEACON
+  memLine(F("fsq"),     mem_fsq);
+#endif
+  memLine(F("free"),    SP - heap_end);
+
+  for (i=0; i<PROF_COUNT; i++) {
+      if (stack_low[i]==0) continue;
+      Serial.print(F("STACK:"));
+      Serial.print(FH(pgm_read_word(&prof_names[i])));
+      Serial.print(FH(S_COLON));
+      Serial.print(RAMEND - stack_low[i]);
+      Serial.print(FH(S_COMMA));
+      Serial.println(stack_low[i] - heap_end);
+  }
+}
+#endif // HAVE_MEMSTATS
+
+#if HAVE_EVENTLOG
+/*
+ * Event trace. A ring buffer of the last EVENTLOG_LEN events, so the order and timing of
+ * TX/RX switching, filter changes and retunes can be seen after the fact.
+ * The arg depends on the event: txcause for TX events, filter bits, frequency in Hz, mode or key state.
+ */
+#define EVENTLOG_LEN 32
+
+static const char S_EV_TXON  [] PROGMEM = "txon";
+static const char S_EV_TXREADY[] PROGMEM = "txready";
+static const char S_EV_TXOFF [] PROGMEM = "txoff";
+static const char S_EV_TXDIS [] PROGMEM = "txdis";
+static const char S_EV_FILTER[] PROGMEM = "filter";
+static const char S_EV_VFO   [] PROGMEM = "vfo";
+static const char S_EV_BFO   [] PROGMEM = "bfo";
+static const char S_EV_MODE  [] PROGMEM = "mode";
+static const char S_EV_KEY   [] PROGMEM = "key";
+static PGM_P const ev_names[EV_COUNT] PROGMEM = {
+  S_EV_TXON, S_EV_TXREADY, S_EV_TXOFF, S_EV_TXDIS, S_EV_FILTER, S_EV_VFO, S_EV_BFO, S_EV_MODE, S_EV_KEY
+};
+
+struct event {
+  unsigned long t;
+  long          arg;
+  byte          type;
+};
+static struct event ev_log[EVENTLOG_LEN];
+static byte ev_head=0;  // next slot to write
+static bool ev_full=false;
+
+void evLog(enum evtype type, long arg) {
+  struct event *e = &ev_log[ev_head];
+  e->t    = micros();
+  e->arg  = arg;
+  e->type = type;
+  if (++ev_head>=EVENTLOG_LEN) {
+     ev_head=0;
+     ev_full=true;
+  }
+}
+
+// Dump to Serial as EV:time,time since previous event,name,arg - oldest first.
+// The log is left as it is so it can be dumped again.
+void evDump() {
+  byte i = ev_full ? ev_head : 0;
+  byte n = ev_full ? EVENTLOG_LEN : ev_head;
+  unsigned long prev = ev_log[i].t;
+  while (n--) {
+     struct event *e = &ev_log[i];
+     Serial.print(F("EV:"));
+     Serial.print(e->t);
+     Serial.print(FH(S_COMMA));
+     Serial.print(e->t - prev);
+     Serial.print(FH(S_COMMA));
+     Serial.print(FH(pgm_read_word(&ev_names[e->type])));
+     Serial.print(FH(S_COMMA));
+     Serial.println(e->arg);
+     prev = e->t;
+     if (++i>=EVENTLOG_LEN) i=0;
+  }
+}
+#endif // HAVE_EVENTLOG
+
+#if HAVE_TRACE
+/*
+ * Input trace. Every change seen on the tuning pot, keyer, meters, PTT and function button,
+ * and every line received on the serial port, goes to Serial as TR:time,kind,pin,value
+ * or TR:time,rx,text as it happens. sim/bitxsim -r replays a saved trace, so loop() timing
+ * and latency can be measured the same way every time for the same operating session.
+ * 9600 baud is about 40 lines a second, so the meters, which are read every few ms, are only
+ * traced every TRACE_METER_MS. An analog change never waits for the serial port either: if the
+ * transmit buffer is short of a line, it goes out with a later reading instead.
+ */
+#define TRACE_ADC_STEP 2    // smaller changes of an analog input are noise
+#define TRACE_METER_MS 200  // the meters are only shown this often anyway
+#define TRACE_LINE     24   // longest TR: line for an input, with CR LF
+
+static const char S_TR  [] PROGMEM = "TR:";
+static const char S_ADC [] PROGMEM = ",adc,";
+static const char S_PIN [] PROGMEM = ",pin,";
+static const char S_RX  [] PROGMEM = ",rx,";
+
+static int tr_adc[8];
+static unsigned long tr_adc_ms[8]; // when each was last traced
+static byte tr_adc_seen=0;       // bit per analog input, set once it has been traced
+static unsigned long tr_pins=0;  // last level traced, bit per digital pin
+static unsigned long tr_pins_seen=0;
+
+static void traceLine(unsigned long t, PGM_P kind, byte pin, int value) {
+  Serial.print(FH(S_TR));
+  Serial.print(t);
+  Serial.print(FH(kind));
+  Serial.print(pin);
+  Serial.print(FH(S_COMMA));
+  Serial.println(value);
+}
+
+int traceAnalogRead(byte pin) {
+  int v=analogRead(pin);
+  byte i=pin-A0;
+  if (tr_adc_seen & _BV(i)) {
+     if (abs(v - tr_adc[i]) < TRACE_ADC_STEP) return v;
+     if (pin!=ANALOG_TUNING && pin!=ANALOG_KEYER && millis() - tr_adc_ms[i] < TRACE_METER_MS) return v;
+  }
+  if (Serial.availableForWrite() < TRACE_LINE) return v;
+  tr_adc_seen |= _BV(i);
+  tr_adc[i] = v;
+  tr_adc_ms[i] = millis();
+  traceLine(micros(), S_ADC, pin, v);
+  return v;
+}
+
+void tracePin(unsigned long t, byte pin, int level) {
+  unsigned long b = 1UL << pin;
+  if ((tr_pins_seen & b) && !(tr_pins & b) == !level) return;
+  tr_pins_seen |= b;
+  if (level) tr_pins |= b; else tr_pins &= ~b;
+  traceLine(t, S_PIN, pin, level);
+}
+
+int traceDigitalRead(byte pin) {
+  int v=digitalRead(pin);
+  tracePin(micros(), pin, v);
+  return v;
+}
+
+void traceRx(unsigned long t, const char *line) {
+  Serial.print(FH(S_TR));
+  Serial.print(t);
+  Serial.print(FH(S_RX));
+  Serial.println(line);
+}
+#endif // HAVE_TRACE
@@ -0,0 +1,326 @@
+/*
+ * Si5351 register shadow.
+ * Keeps a copy of the output enable, clock control and multisynth registers of CLK0-2 so a
+ * change only sends the bytes that differ, in one burst from the first changed register to the last.
+ * Retuning by a few Hz usually touches 2-4 bytes of a multisynth, and repeated drive strength or
+ * output enable settings while keying send nothing at all.
+ *
+ * Between synthBegin() and synthCommit() the changes are only staged. The commit then sends
+ * the multisynths of all the clocks in one burst, so a BFO and VFO move together and the output
+ * doesn't sit on a wrong frequency in between. The PLLs stay at SI5351_PLL_FIXED, so no PLL reset.
+ *
+ * synthPrepare() keeps ready-made multisynth blocks in slots for the frequencies we are likely to
+ * switch to (RX with RIT, TX, the other VFOs). Setting one of those is just a copy and a burst write.
+ *
+ * The first time a clock is used it goes through the library, which does the output power-up
+ * and the rest of its housekeeping, and the shadow is read back from the chip. The multisynth
+ * registers are computed here for 500kHz-100MHz with the PLL at SI5351_PLL_FIXED, anything else
+ * is left to the library and read back again.
+ *
+ * The divider is worked out in 1/16 Hz units with 32 bit arithmetic. Only a change of its integer
+ * part needs 64 bit divides, the fraction comes from a 20 step long division using the largest
+ * denominator the chip takes. Much faster than the library's 64 bit maths on every tuning step,
+ * but coarser than its 1/100 Hz: fine offsets (FSQ and WSPR tones) land on the nearest 1/16 Hz.
+ */
+
+#include "bitxultra.h"
+
+#define SYNTH_CLOCKS   3            // CLK0-2
+#define SYNTH_MIN_FREQ 500000UL     // below this the library uses the R divider
+#define SYNTH_MAX_FREQ 100000000UL  // above this the library changes PLL and integer mode
+#define SYNTH_FRAC_BITS 20
+#define SYNTH_DENOM    ((1UL<<SYNTH_FRAC_BITS)-1) // p3, the largest the chip takes
+// Frequencies are in 1/16 Hz steps (0.0625 Hz), so 100MHz still fits in 32 bits.
+// The library's 1/100 Hz would need 64. A WSPR tone (1.46 Hz spacing) is within 1/32 Hz.
+#define SYNTH_PLL      (SI5351_PLL_FIXED*16/SI5351_FREQ_MULT) // PLL in 1/16 Hz
+
+// Bus cost of a library set_freq(), including the register reads it does for read-modify-write.
+// Data bytes only, not counting the device address byte.
+#define SI5351_SETFREQ_TXNS  12 // output_enable, MS params, int mode and R div
+#define SI5351_SETFREQ_BYTES 23
+
+#define MS_INT_MODE    0x40         // CLKx_CTRL
+#define MS_DRIVE_MASK  0x03
+
+struct synthregs {
+  byte oe;                   // register 3, bit set = output disabled
+  byte ctrl[SYNTH_CLOCKS];   // registers 16-18
+  byte ms[SYNTH_CLOCKS][8];  // registers 42-65
+};
+#if HAVE_FASTBOOT
+// Kept over a warm boot in .noinit, with a check byte, for synthRestore().
+static struct synthregs synth_chip __attribute__((section(".noinit")));  // what the chip has
+static byte synth_live __attribute__((section(".noinit")));              // bit per clock, shadow is valid
+static byte synth_check __attribute__((section(".noinit")));
+#else
+static struct synthregs synth_chip;  // what the chip has
+static byte synth_live=0;            // bit per clock, shadow is valid
+#endif
+static struct synthregs synth_next;  // what it should have after the commit
+static byte synth_batch=0;           // synthBegin() nesting
+
+// The integer part of each clock's divider and the range of frequencies it covers, 1/16 Hz units.
+struct synthdiv {
+  uint32_t fmin, fmax;
+  uint16_t a;
+};
+static struct synthdiv synth_div[SYNTH_CLOCKS];
+
+// Precomputed multisynth blocks. F==0 is an empty slot.
+struct synthslot {
+  uint32_t F;
+  byte     clk;
+  byte     ms[8];
+};
+static struct synthslot synth_slot[SYNTH_SLOTS];
+
+#if HAVE_I2CSTATS
+/*
+ * The bus traffic is counted by what the registers are for, so a commit of several clocks
+ * still shows where its bytes went: each clock's multisynth against the VFO or the BFO,
+ * the clock controls and output enables (drive strength and keying) against the key.
+ */
+static enum i2cuser synthUser(byte clk) {
+  return clk==BFO_OUTPUT ? I2C_BFO : I2C_VFO;
+}
+
+// Share a burst of bytes first..last of the block at reg between the users by the bytes each got.
+// The transaction and register address go with the first.
+static void synthAccount(byte reg, byte first, byte last, unsigned long t) {
+  unsigned long us = micros() - t;
+  byte per = sizeof(synth_chip.ms[0]), n = last-first+1, i, end, extra=1;
+
+  if (reg!=SI5351_CLK0_PARAMETERS) {
+     i2cCount(I2C_KEY, 1, n+1, us);
+     return;
+  }
+  for (i=first; i<=last; i=end) {
+      end = (i/per+1)*per;
+      if (end>last+1) end = last+1;
+      i2cCount(synthUser(i/per), extra, end-i+extra, us*(end-i)/n);
+      extra = 0;
+  }
+}
+#endif
+
+// Write the bytes of want that differ from the shadow in one burst, and update the shadow.
+static void synthWrite(byte reg, byte *shadow, const byte *want, byte n) {
+  byte first, last;
+  #if HAVE_I2CSTATS
+  unsigned long t=micros();
+  #endif
+
+  for (first=0; first<n && shadow[first]==want[first]; first++);
+  if (first==n) return;
+  for (last=n-1; shadow[last]==want[last]; last--);
+
+  memcpy(&shadow[first], &want[first], last-first+1);
+  if (first==last) {
+     si5351.si5351_write(reg+first, want[first]);
+  } else {
+     si5351.si5351_write_bulk(reg+first, last-first+1, &shadow[first]);
+  }
+  #if HAVE_I2CSTATS
+  synthAccount(reg, first, last, t);
+  #endif
+}
+
+#if HAVE_FASTBOOT
+static byte synthCheck() {
+  const byte *p = (const byte *)&synth_chip;
+  byte i, sum = synth_live ^ 0x5A;
+  for (i=0; i<sizeof(synth_chip); i++) sum = (sum << 1 | sum >> 7) ^ p[i];
+  return sum;
+}
+#endif
+
+// Send everything that has been staged. Multisynths first so an output is enabled on its new frequency.
+static void synthFlush() {
+  synthWrite(SI5351_CLK0_PARAMETERS,    synth_chip.ms[0], synth_next.ms[0], sizeof(synth_chip.ms));
+  synthWrite(SI5351_CLK0_CTRL,          synth_chip.ctrl,  synth_next.ctrl,  sizeof(synth_chip.ctrl));
+  synthWrite(SI5351_OUTPUT_ENABLE_CTRL, &synth_chip.oe,   &synth_next.oe,   1);
+  #if HAVE_FASTBOOT
+  synth_check = synthCheck();
+  #endif
+}
+
+// Read a clock's registers back from the chip after the library has changed them.
+// Anything staged for the other clocks is kept.
+static void synthSync(enum si5351_clock clk) {
+  byte i;
+  #if HAVE_I2CSTATS
+  unsigned long t=micros();
+  #endif
+  synth_chip.oe = si5351.si5351_read(SI5351_OUTPUT_ENABLE_CTRL);
+  if (synth_live) {
+     synth_next.oe = (synth_next.oe & ~_BV(clk)) | (synth_chip.oe & _BV(clk));
+  } else {
+     synth_next.oe = synth_chip.oe; // includes the clocks we don't use
+  }
+  synth_chip.ctrl[clk] = synth_next.ctrl[clk] = si5351.si5351_read(SI5351_CLK0_CTRL + clk);
+  for (i=0; i<8; i++) {
+      synth_chip.ms[clk][i] = synth_next.ms[clk][i] = si5351.si5351_read(SI5351_CLK0_PARAMETERS + clk*8 + i);
+  }
+  synth_live |= _BV(clk);
+  #if HAVE_FASTBOOT
+  synth_check = synthCheck();
+  #endif
+  #if HAVE_I2CSTATS
+  i2cCount(synthUser(clk), 10*2, 10*2, micros() - t);
+  #endif
+}
+
+#if HAVE_FASTBOOT
+/*
+ * Call from setup() after the library has set up the chip, before the first frequency is set.
+ * On a warm boot the shadow still holds what CLK0-2 were set to, so put all of it back in one
+ * burst for the multisynths, one for the clock controls and the output enables, and carry on
+ * from the shadow without the library's set_freq() and the read back. Otherwise, or if the
+ * shadow was caught half written, start with an empty one.
+ */
+void synthRestore(bool warm) {
+  byte i;
+  if (!warm || !synth_live || synth_check != synthCheck()) {
+     synth_live=0;
+     return;
+  }
+  memcpy(&synth_next, &synth_chip, sizeof(synth_next));
+  for (i=0; i<sizeof(synth_chip); i++) ((byte *)&synth_chip)[i] = ~((byte *)&synth_next)[i];
+  synthFlush(); // everything differs, so each block goes whole
+}
+#endif
+
+// Multisynth parameters for clk at F/16 Hz.
+static void synthCalc(enum si5351_clock clk, uint32_t F, byte *ms) {
+  struct synthdiv *d = &synth_div[clk];
+  uint32_t r0, r, b, p1, p2;
+  byte i;
+
+  if (F<d->fmin || F>d->fmax) { // integer part has changed
+     d->a    = SYNTH_PLL / F;
+     d->fmin = SYNTH_PLL / (d->a+1) + 1;
+     d->fmax = SYNTH_PLL / d->a;
+  }
+
+  // The remainder of PLL/F is less than F, so it comes out right from the low 32 bits of the PLL.
+  r0 = r = (uint32_t)SYNTH_PLL - d->a*F;
+
+  // b = r*2^20/F, then scale to r*(2^20-1)/F
+  b = 0;
+  for (i=0; i<SYNTH_FRAC_BITS; i++) {
+      r <<= 1;
+      b <<= 1;
+      if (r>=F) {
+         r -= F;
+         b |= 1;
+      }
+  }
+  if (r<r0) b--;
+
+  // p1 = 128*a + 128*b/c - 512, p2 = 128*b % c, without dividing by c=2^20-1
+  b <<= 7;
+  p1 = b >> SYNTH_FRAC_BITS;
+  p2 = (b & ((1UL<<SYNTH_FRAC_BITS)-1)) + p1;
+  if (p2>=SYNTH_DENOM) {
+     p1++;
+     p2 -= SYNTH_DENOM;
+  }
+  p1 += ((uint32_t)d->a << 7) - 512;
+
+  ms[0] = (SYNTH_DENOM >> 8) & 0xFF;                        // P3[15:8]
+  ms[1] = SYNTH_DENOM & 0xFF;                               // P3[7:0]
+  ms[2] = (ms[2] & 0x80) | ((p1 >> 16) & 0x03);             // no R divider or divide by 4
+  ms[3] = p1 >> 8;
+  ms[4] = p1;
+  ms[5] = (((SYNTH_DENOM >> 16) & 0x0F) << 4) | ((p2 >> 16) & 0x0F); // P3[19:16], P2[19:16]
+  ms[6] = p2 >> 8;
+  ms[7] = p2;
+}
+
+// f Hz plus fine/SI5351_FREQ_MULT Hz in 1/16 Hz, fine rounded to the nearest step.
+static uint32_t synthUnits(Frequency f, long fine) {
+  long half = (long)SI5351_FREQ_MULT / 2;
+  return (f << 4) + (fine * 16 + (fine<0 ? -half : half)) / (long)SI5351_FREQ_MULT;
+}
+
+static struct synthslot *synthFind(enum si5351_clock clk, uint32_t F, struct synthslot *skip) {
+  byte i;
+  for (i=0; i<SYNTH_SLOTS; i++) {
+      struct synthslot *s = &synth_slot[i];
+      if (s!=skip && s->F==F && s->clk==clk) return s;
+  }
+  return NULL;
+}
+
+// Have the block for clk at f ready in slot. Only worked out when it has changed.
+void synthPrepare(byte slot, enum si5351_clock clk, Frequency f, long fine) {
+  struct synthslot *s = &synth_slot[slot], *t;
+  uint32_t F;
+
+  if (clk>=SYNTH_CLOCKS || f<SYNTH_MIN_FREQ || f>=SYNTH_MAX_FREQ) {
+     s->F = 0;
+     return;
+  }
+  F = synthUnits(f, fine);
+  if (s->F==F && s->clk==clk) return;
+
+  s->F   = F;
+  s->clk = clk;
+  if ((t = synthFind(clk, F, s))) {
+     memcpy(s->ms, t->ms, sizeof(s->ms));
+  } else {
+     synthCalc(clk, F, s->ms);
+  }
+}
+
+// Set clk to f Hz plus fine/SI5351_FREQ_MULT Hz.
+// A clock the shadow doesn't handle yet is set straight away, even in a batch.
+void synthSetFreq(enum si5351_clock clk, Frequency f, long fine) {
+  if (clk>=SYNTH_CLOCKS || !(synth_live & _BV(clk)) || f<SYNTH_MIN_FREQ || f>=SYNTH_MAX_FREQ) {
+     #if HAVE_I2CSTATS
+     unsigned long t=micros();
+     #endif
+     si5351.set_freq(((uint64_t)f * SI5351_FREQ_MULT) + fine, clk);
+     #if HAVE_I2CSTATS
+     i2cCount(synthUser(clk), SI5351_SETFREQ_TXNS, SI5351_SETFREQ_BYTES, micros() - t);
+     #endif
+     if (clk<SYNTH_CLOCKS) synthSync(clk);
+     return;
+  }
+
+  uint32_t F = synthUnits(f, fine);
+  struct synthslot *s = synthFind(clk, F, NULL);
+  byte *ms = synth_next.ms[clk];
+  if (s) {
+     byte keep = ms[2] & 0x80;
+     memcpy(ms, s->ms, sizeof(s->ms));
+     ms[2] |= keep;
+  } else {
+     synthCalc(clk, F, ms);
+  }
+  synth_next.ctrl[clk] &= ~MS_INT_MODE;
+  if (!synth_batch) synthFlush();
+}
+
+void synthDrive(enum si5351_clock clk, enum si5351_drive drive) {
+  if (!(synth_live & _BV(clk))) synthSync(clk);
+  synth_next.ctrl[clk] = (synth_next.ctrl[clk] & ~MS_DRIVE_MASK) | drive;
+  if (!synth_batch) synthFlush();
+}
+
+void synthEnable(enum si5351_clock clk, bool on) {
+  if (!(synth_live & _BV(clk))) synthSync(clk);
+  if (on) synth_next.oe &= ~_BV(clk);
+  else    synth_next.oe |=  _BV(clk);
+  if (!synth_batch) synthFlush();
+}
+
+// Stage the synth changes until the matching synthCommit(). May be nested.
+void synthBegin() {
+  synth_batch++;
+}
+
+void synthCommit() {
+  if (synth_batch && --synth_batch) return;
+  synthFlush();
+}
@@ -10,6 +10,10 @@
  */
 #include <EEPROM.h>
 
+#if HAVE_SLEEP
+#include <avr/sleep.h>
+#endif
+
 const PROGMEM char S_USB[]="USB";
 const PROGMEM char S_LSB[]="LSB";
 const PROGMEM char S_AUTO[]="AUTO";
@@ -187,9 +191,11 @@ void print_beacon_text() {
   }
   Serial.println();
 }
+#endif
 
+#if HAVE_CW_SENDER
 // helper func to save including EEPROM.h in cw.cpp
-byte getEEPROMByte(unsigned int addr) {
+byte getEEPROMByte(uintptr_t addr) {
   return EEPROM.read(addr);
 }
 #endif
@@ -220,20 +226,112 @@ bool interval(unsigned long *last, unsigned int limit) {
      *last=now;
      return true;
   }
+  schedAt(*last + limit);
   return false;
 }
 
+/*
+ * Task deadlines. Each task body starts with
+ *  if (!taskDue(TASK_X)) return;
+ * and then says when it wants to run next with taskNext() (relative to the start of this run)
+ * or taskIn() (relative to now). A task that doesn't set a new deadline runs on every pass of loop().
+ * Every deadline looked at during a pass of loop() is remembered, so schedWait() at the end of
+ * loop() only waits until the earliest of them. Tasks that aren't run in the current mode don't
+ * get looked at, so they don't wake us up.
+ */
+static unsigned long task_due[TASK_COUNT];
+static unsigned long sched_next;
+static bool          sched_pending=false;
+
+void schedAt(unsigned long when) {
+  if (!sched_pending || (long)(when - sched_next) < 0) {
+     sched_next=when;
+     sched_pending=true;
+  }
+}
+
+bool taskDue(enum task t) {
+  register unsigned long now=millis();
+  if ((long)(now - task_due[t]) >= 0) {
+     task_due[t]=now;
+     return true;
+  }
+  schedAt(task_due[t]);
+  return false;
+}
+
+void taskNext(enum task t, unsigned long ms) {
+  task_due[t] += ms;
+  schedAt(task_due[t]);
+}
+
+void taskIn(enum task t, unsigned long ms) {
+  task_due[t] = millis() + ms;
+  schedAt(task_due[t]);
+}
+
+void taskNow(enum task t) {
+  task_due[t] = millis();
+}
+
+#if HAVE_SLEEP
+static unsigned long sleep_us=0, sleep_start=0;
+
+// Time asleep and awake since the last call, in ms.
+void sleepStats(unsigned long &asleep, unsigned long &awake) {
+  unsigned long now=micros();
+  asleep = sleep_us / 1000;
+  awake  = (now - sleep_start - sleep_us) / 1000;
+  sleep_us=0;
+  sleep_start=now;
+}
+#endif
+
+// Wait for the earliest deadline seen this pass, but no more than SCHED_POLL ms
+// so the inputs without a task (PTT, button...) still get polled.
+// With HAVE_SLEEP the CPU idles until the next interrupt. The millis() timer wakes it at least every ms.
+void schedWait() {
+  register unsigned long until=millis() + SCHED_POLL;
+  if (sched_pending && (long)(sched_next - until) < 0) until=sched_next;
+  sched_pending=false;
+  while ((long)(millis() - until) < 0) {
+     #if HAVE_SLEEP
+     cli();
+     #endif
+     #if HAVE_CAT
+     if (Serial.available()) break; // let serialEvent() have it now.
+     #endif
+     #if HAVE_PCINT
+     if (pcintPending()) break;
+     #endif
+     #if HAVE_SLEEP
+     unsigned long t=micros();
+     set_sleep_mode(SLEEP_MODE_IDLE);
+     sleep_enable();
+     sei();       // the instruction after sei() always runs, so an interrupt can't sneak in before the sleep
+     sleep_cpu();
+     sleep_disable();
+     sleep_us += micros() - t;
+     #endif
+  }
+  #if HAVE_SLEEP
+  sei();
+  #endif
+}
+
 #define BLEEP_QLEN 10
-static unsigned long bleep_last=0;
 static byte bleep_head=0, bleep_tail=0;
 static byte bleep_freq[BLEEP_QLEN], bleep_len[BLEEP_QLEN];
+#if HAVE_MEMSTATS
+const unsigned int mem_bleep = sizeof(bleep_freq) + sizeof(bleep_len);
+#endif
 
 void bleep(unsigned int freq, unsigned int duration) {
   bleep_freq[bleep_head]=freq/10;
   bleep_len [bleep_head]=duration/10;
   if (bleep_head==bleep_tail) {
      tone(CW_TONE, freq);
-     bleep_last=millis();
+     taskIn(TASK_BLEEP, bleep_len[bleep_head]*10);
   }
   bleep_head++;
   if (bleep_head>=BLEEP_QLEN) bleep_head=0;
@@ -249,7 +347,7 @@ void bleeps(unsigned int freq, unsigned int duration, byte count, unsigned int g
 
 void bleep_check() {
   if (bleep_head!=bleep_tail) {
-     if (interval(&bleep_last, bleep_len[bleep_tail]*10)) {
+     if (taskDue(TASK_BLEEP)) {
         bleep_tail++;
         if (bleep_tail>=BLEEP_QLEN) bleep_tail=0;
         if ((bleep_head!=bleep_tail) && bleep_freq[bleep_tail]) {
@@ -257,6 +355,7 @@ void bleep_check() {
         } else {
            noTone(CW_TONE);
         }
+        if (bleep_head!=bleep_tail) taskNext(TASK_BLEEP, bleep_len[bleep_tail]*10);
      }
   }
 }
@@ -267,29 +366,163 @@ void bleep_check() {
 
 // non-debounced
 inline bool _btnDown() {
-  return digitalRead(FBUTTON) != HIGH;
+  return DIGITAL_READ(FBUTTON) != HIGH;
 }
 
-// debounced
+// debounced, blocking. Only for setup() and other places where nothing else is running.
 bool btnDown(){
   if (_btnDown()) {
-     delay(40);
+     delay(BTN_DEBOUNCE);
      return _btnDown();
   }
   return false;
 }
 
-int waitBtnUp() {
-  unsigned int timeout = 10000;
-  unsigned long duration=0, start=millis();  
-  do {
-    while (_btnDown() && (duration=(millis()-start)) < timeout) {
-        delay(10);
-    }
-    delay(10);
-  } while (_btnDown() && (duration < timeout));
-  
-  return duration;
+/*
+ * Button gestures. btnPoll() is called on every pass of loop() and turns the button (and the
+ * tuning knob while the button is down) into tap, double tap, hold and turn events.
+ * An event can be read with btnEvent() during the pass of loop() it happens in, then it's gone.
+ * Nothing waits for the button, the timeouts are deadlines for the scheduler.
+ *
+ * A tap is only reported once TAP_UP_MILLIS has passed without a second press. A press longer
+ * than TAP_DOWN_MILLIS can't start a double tap, so it's a tap as soon as it's released.
+ * Hold and turn are reported while the button is still down, and a gesture
+ * ends when the button is released.
+ */
+enum btnstate { BS_IDLE, BS_DOWN, BS_UP, BS_WAITUP };
+static enum btnstate btn_state=BS_IDLE;
+static enum btnevent btn_event=BTN_NONE;
+static bool          btn_level=false;
+static unsigned long btn_start=0;
+#if !HAVE_PCINT
+static bool          btn_raw=false;
+static unsigned long btn_change=0;
+#endif
+static int           btn_knob;
+
+void btnPoll() {
+  register unsigned long now=millis();
+  bool edge=false;
+
+  btn_event=BTN_NONE;
+
+#if HAVE_PCINT
+  edge=pcintChanged(PC_BUTTON);
+  btn_level=pcintLevel(PC_BUTTON);
+#else
+  // debounce
+  bool raw=_btnDown();
+  if (raw != btn_raw) {
+     btn_raw=raw;
+     btn_change=now;
+  }
+  if (btn_raw != btn_level) {
+     if (now - btn_change >= BTN_DEBOUNCE) {
+        btn_level=btn_raw;
+        edge=true;
+     } else {
+        schedAt(btn_change + BTN_DEBOUNCE);
+     }
+  }
+#endif
+
+  switch (btn_state) {
+    case BS_IDLE:
+         if (edge && btn_level) {
+            btn_state=BS_DOWN;
+            btn_start=now;
+            btn_knob=knobPos();
+         }
+         break;
+
+    case BS_DOWN:
+         if (edge) { // released
+            if (now - btn_start <= TAP_DOWN_MILLIS) {
+               btn_state=BS_UP;
+            } else { // too slow to start a double tap, but short of a hold
+               btn_event=BTN_TAP;
+               btn_state=BS_IDLE;
+            }
+            btn_start=now;
+         } else if (abs(knobPos() - btn_knob) > 10) {
+            btn_event=BTN_TURN;
+            btn_state=BS_WAITUP;
+         } else if (now - btn_start >= TAP_HOLD_MILLIS) {
+            btn_event=BTN_HOLD;
+            btn_state=BS_WAITUP;
+         } else {
+            schedAt(btn_start + TAP_HOLD_MILLIS);
+         }
+         break;
+
+    case BS_UP: // after a tap, waiting to see if there's another
+         if (edge) {
+            btn_event=BTN_DOUBLE;
+            btn_state=BS_WAITUP;
+         } else if (now - btn_start >= TAP_UP_MILLIS) {
+            btn_event=BTN_TAP;
+            btn_state=BS_IDLE;
+         } else {
+            schedAt(btn_start + TAP_UP_MILLIS);
+         }
+         break;
+
+    case BS_WAITUP:
+         if (edge) btn_state=BS_IDLE;
+         break;
+  }
+}
+
+enum btnevent btnEvent() {
+  return btn_event;
+}
+
+// debounced state of the button, for things that need to know it's still down.
+bool btnHeld() {
+  return btn_level;
+}
+
+/*
+ * Tuning knob. knobPoll() reads the pot for everyone every KNOB_SAMPLE ms: KNOB_OVERSAMPLE
+ * conversions are averaged, and the position only follows when the reading gets more than
+ * KNOB_HYSTERESIS away, so ADC noise doesn't retune anything. The ends of the travel are
+ * exact so "knob fully over" tests still work.
+ */
+static int knob_pos=-1;
+static int knob_vel=0;
+
+void knobPoll() {
+  unsigned int sum=0;
+  int raw, pos;
+  byte i;
+
+  if (!taskDue(TASK_KNOB)) return;
+  taskNext(TASK_KNOB, KNOB_SAMPLE);
+
+  for (i=0; i<KNOB_OVERSAMPLE; i++) sum += ANALOG_READ(ANALOG_TUNING);
+  raw = (sum + KNOB_OVERSAMPLE/2) / KNOB_OVERSAMPLE;
+
+  pos = knob_pos<0 ? raw : knob_pos;
+  if      (raw <= KNOB_HYSTERESIS)        pos = 0;
+  else if (raw >= 1023-KNOB_HYSTERESIS)   pos = 1023;
+  else if (raw >  pos+KNOB_HYSTERESIS)    pos = raw-KNOB_HYSTERESIS;
+  else if (raw <  pos-KNOB_HYSTERESIS)    pos = raw+KNOB_HYSTERESIS;
+
+  if (knob_pos>=0) { // lightly smoothed. A full swing in one sample is 204600/s, so in long and clamped.
+     long vel = (knob_vel + (long)(pos-knob_pos) * (1000/KNOB_SAMPLE)) / 2;
+     knob_vel = constrain(vel, -32767L, 32767L);
+  }
+  knob_pos = pos;
+}
+
+// 0-1023, filtered
+int knobPos() {
+  return knob_pos;
+}
+
+// counts per second, positive is clockwise
+int knobVelocity() {
+  return knob_vel;
 }
 
 /*
@@ -308,7 +541,7 @@ unsigned long pow10(unsigned int x) {
 #endif
 
 
-#if HAVE_PULSE
+#if HAVE_PULSE || HAVE_MEMSTATS
 
 #define STACK_CANARY_VAL 0xFD
 
@@ -343,6 +576,37 @@ uint16_t getMinFreeSpace() {
   }
   return p - (uint8_t *)(__brkval == 0 ? (int) &__heap_start : (int) __brkval);
 }
-#endif // HAVE_PULSE
+#endif // HAVE_PULSE || HAVE_MEMSTATS
+
+#if HAVE_MEMSTATS
+uint16_t getHeapEnd() {
+  return (__brkval == 0 ? (int) &__heap_start : (int) __brkval);
+}
+
+/*
+ * Find the lowest address the stack has reached since the last call, then mark the space
+ * above it so the next call only sees what happened in between.
+ * The mark isn't the canary, so getMinFreeSpace() still stops at the deepest the stack has
+ * ever been. Scans up from the heap end to the first byte that is neither, so stack data that
+ * happens to look like the canary can't end the scan early. A few bytes below SP are left alone
+ * in case the compiler pushes anything while we mark, and interrupts are off so we can't mark
+ * over an ISR's frame.
+ */
+#define STACK_STAGE_VAL 0xFC
+#define STACK_CANARY_MARGIN 16
+
+uint16_t getStackLow() {
+  uint8_t *top = (uint8_t *)SP - STACK_CANARY_MARGIN;
+  uint8_t *low = (uint8_t *)getHeapEnd(), *p;
+
+  while (low < top && (*low == STACK_CANARY_VAL || *low == STACK_STAGE_VAL)) low++;
+
+  uint8_t sreg = SREG;
+  cli();
+  for (p=low; p<top; p++) *p = STACK_STAGE_VAL;
+  SREG = sreg;
+  return (uint16_t)low;
+}
+#endif // HAVE_MEMSTATS
 
 